@@ -1 +1 @@
-g++ -o main src/*.c -Wuninitialized
\ No newline at end of file
+g++ -o main src/*.c -Wuninitialized -pthread
\ No newline at end of file
@@ -0,0 +1,279 @@
+#include "all_different.h"
+#include "arena.h"
+#include "memory.h"
+
+#define NONE SIZE_MAX
+
+// Create work
+AllDifferentWork *create_all_different_work(Constraints *constraints, Arena *arena)
+{
+    size_t max_variables = 0;
+    size_t max_values = 0;
+    for (size_t a = 0; a < constraints->all_differents_count; a++)
+    {
+        AllDifferent *all_different = constraints->all_differents + a;
+        if (all_different->variable_indexes_count > max_variables)
+            max_variables = all_different->variable_indexes_count;
+        if (all_different->values_count > max_values)
+            max_values = all_different->values_count;
+    }
+
+    AllDifferentWork *work = ARENA_NEW(arena, AllDifferentWork);
+    work->value_owners = ARENA_ARRAY(arena, size_t, max_values + 1);
+    work->value_parents = ARENA_ARRAY(arena, size_t, max_values + 1);
+    work->visited_values = ARENA_ARRAY(arena, size_t, max_values + 1);
+    work->variable_queue = ARENA_ARRAY(arena, size_t, max_variables + 1);
+
+    work->variable_orders = ARENA_ARRAY(arena, size_t, max_variables + 1);
+    work->variable_lowlinks = ARENA_ARRAY(arena, size_t, max_variables + 1);
+    work->variable_components = ARENA_ARRAY(arena, size_t, max_variables + 1);
+    work->stack = ARENA_ARRAY(arena, size_t, max_variables + 1);
+    work->call_stack = ARENA_ARRAY(arena, size_t, max_variables + 1);
+    work->next_values = ARENA_ARRAY(arena, int, max_variables + 1);
+    work->component_reaches_free = ARENA_ARRAY(arena, bool, max_variables + 1);
+
+    for (size_t v = 0; v < max_values; v++)
+        work->value_parents[v] = NONE;
+
+    return work;
+}
+
+// Matching
+// Search (breadth first) for a path from an unmatched variable to an unmatched value, which alternates between
+// values in a variable's domain and the variable that value is matched to. Moving every variable along the path
+// onto the next value matches one more variable. Returns false if there is no such path.
+bool augment_matching(Propagator *propagator, AllDifferent *all_different, int *matched_values, size_t start)
+{
+    AllDifferentWork *work = propagator->all_different_work;
+    int min_value = all_different->min_value;
+
+    size_t visited_count = 0;
+    size_t queue_start = 0;
+    size_t queue_count = 0;
+    work->variable_queue[queue_count++] = start;
+
+    bool augmented = false;
+    while (queue_start < queue_count && !augmented)
+    {
+        size_t n = work->variable_queue[queue_start++];
+        Domain domain = get_domain(propagator->quantum_map, all_different->variable_indexes[n]);
+
+        for (int value = first_domain_value(domain); value != NO_VALUE; value = domain_value_after(domain, value))
+        {
+            size_t v = (size_t)(value - min_value);
+            if (work->value_parents[v] != NONE)
+                continue;
+
+            work->value_parents[v] = n;
+            work->visited_values[visited_count++] = v;
+
+            if (work->value_owners[v] != NONE)
+            {
+                work->variable_queue[queue_count++] = work->value_owners[v];
+                continue;
+            }
+
+            // Move each variable on the path back to `start` onto the value after it
+            while (true)
+            {
+                size_t parent = work->value_parents[v];
+                int previous_value = matched_values[parent];
+                matched_values[parent] = (int)v + min_value;
+                work->value_owners[v] = parent;
+
+                if (parent == start)
+                    break;
+
+                v = (size_t)(previous_value - min_value);
+            }
+
+            augmented = true;
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < visited_count; i++)
+        work->value_parents[work->visited_values[i]] = NONE;
+
+    return augmented;
+}
+
+// Components
+// Variable `n` points to variable `m` if a value in the domain of `n` is matched to `m` (so `n` could take that value
+// if `m` moved to another value). Variables in the same strongly connected component can swap values around a cycle.
+// Tarjan's algorithm finishes components in reverse topological order, so every component that a component points to
+// already knows whether it reaches an unmatched value by the time the component itself is finished.
+void find_components(Propagator *propagator, AllDifferent *all_different)
+{
+    AllDifferentWork *work = propagator->all_different_work;
+    QuantumMap *quantum_map = propagator->quantum_map;
+    size_t variables_count = all_different->variable_indexes_count;
+    int min_value = all_different->min_value;
+
+    for (size_t n = 0; n < variables_count; n++)
+    {
+        work->variable_orders[n] = NONE;
+        work->variable_components[n] = NONE;
+    }
+
+    size_t next_order = 0;
+    size_t components_count = 0;
+    size_t stack_count = 0;
+
+    for (size_t root = 0; root < variables_count; root++)
+    {
+        if (work->variable_orders[root] != NONE)
+            continue;
+
+        size_t call_stack_count = 0;
+        work->call_stack[call_stack_count++] = root;
+        work->variable_orders[root] = work->variable_lowlinks[root] = next_order++;
+        work->stack[stack_count++] = root;
+        work->next_values[root] = first_domain_value(get_domain(quantum_map, all_different->variable_indexes[root]));
+
+        while (call_stack_count > 0)
+        {
+            size_t n = work->call_stack[call_stack_count - 1];
+            int value = work->next_values[n];
+
+            // Visit the variable matched to the next value in the domain
+            if (value != NO_VALUE)
+            {
+                Domain domain = get_domain(quantum_map, all_different->variable_indexes[n]);
+                work->next_values[n] = domain_value_after(domain, value);
+
+                size_t m = work->value_owners[value - min_value];
+                if (m == NONE || m == n)
+                    continue;
+
+                if (work->variable_orders[m] == NONE)
+                {
+                    work->call_stack[call_stack_count++] = m;
+                    work->variable_orders[m] = work->variable_lowlinks[m] = next_order++;
+                    work->stack[stack_count++] = m;
+                    work->next_values[m] = first_domain_value(get_domain(quantum_map, all_different->variable_indexes[m]));
+                }
+
+                // Variables that have been visited but are not yet in a component are still on the stack
+                else if (work->variable_components[m] == NONE && work->variable_orders[m] < work->variable_lowlinks[n])
+                    work->variable_lowlinks[n] = work->variable_orders[m];
+
+                continue;
+            }
+
+            call_stack_count--;
+            if (call_stack_count > 0)
+            {
+                size_t parent = work->call_stack[call_stack_count - 1];
+                if (work->variable_lowlinks[n] < work->variable_lowlinks[parent])
+                    work->variable_lowlinks[parent] = work->variable_lowlinks[n];
+            }
+
+            if (work->variable_lowlinks[n] != work->variable_orders[n])
+                continue;
+
+            // `n` is the root of a component, made up of every variable above it on the stack
+            size_t component_start = stack_count;
+            do
+                component_start--;
+            while (work->stack[component_start] != n);
+
+            size_t component = components_count++;
+            for (size_t s = component_start; s < stack_count; s++)
+                work->variable_components[work->stack[s]] = component;
+
+            bool reaches_free = false;
+            for (size_t s = component_start; s < stack_count && !reaches_free; s++)
+            {
+                Domain domain = get_domain(quantum_map, all_different->variable_indexes[work->stack[s]]);
+                for (int other = first_domain_value(domain); other != NO_VALUE; other = domain_value_after(domain, other))
+                {
+                    size_t owner = work->value_owners[other - min_value];
+                    if (owner == NONE || (work->variable_components[owner] != component && work->component_reaches_free[work->variable_components[owner]]))
+                    {
+                        reaches_free = true;
+                        break;
+                    }
+                }
+            }
+
+            work->component_reaches_free[component] = reaches_free;
+            stack_count = component_start;
+        }
+    }
+}
+
+// Revise all different constraint
+// Returns false if the variables cannot all be matched to different values
+bool revise_all_different(Propagator *propagator, size_t all_different_index)
+{
+    AllDifferent *all_different = propagator->constraints->all_differents + all_different_index;
+    AllDifferentWork *work = propagator->all_different_work;
+    QuantumMap *quantum_map = propagator->quantum_map;
+    Reason reason = (Reason){.kind = REASON_KIND__ALL_DIFFERENT, .index = all_different_index, .id = 0};
+
+    size_t variables_count = all_different->variable_indexes_count;
+    int min_value = all_different->min_value;
+    int *matched_values = propagator->matched_values + propagator->matched_values_offsets[all_different_index];
+
+    // 1. Keep every match that is still possible
+    for (size_t v = 0; v < all_different->values_count; v++)
+        work->value_owners[v] = NONE;
+
+    for (size_t n = 0; n < variables_count; n++)
+    {
+        int value = matched_values[n];
+        Domain domain = get_domain(quantum_map, all_different->variable_indexes[n]);
+
+        if (value != NO_VALUE && domain_contains(domain, value) && work->value_owners[value - min_value] == NONE)
+            work->value_owners[value - min_value] = n;
+        else
+            matched_values[n] = NO_VALUE;
+    }
+
+    // 2. Match every other variable
+    for (size_t n = 0; n < variables_count; n++)
+    {
+        if (matched_values[n] != NO_VALUE)
+            continue;
+
+        if (!augment_matching(propagator, all_different, matched_values, n))
+        {
+            propagator->conflict_var_index = all_different->variable_indexes[n];
+            propagator->conflict_reason = reason;
+            return false;
+        }
+    }
+
+    // 3. Remove every value that is not in any matching
+    find_components(propagator, all_different);
+
+    for (size_t n = 0; n < variables_count; n++)
+    {
+        size_t var_index = all_different->variable_indexes[n];
+        Domain domain = get_domain(quantum_map, var_index);
+        Domain supported = scratch_domain(propagator, var_index);
+        copy_domain(supported, domain);
+
+        bool unsupported = false;
+        for (int value = first_domain_value(domain); value != NO_VALUE; value = domain_value_after(domain, value))
+        {
+            size_t owner = work->value_owners[value - min_value];
+            if (owner == NONE || owner == n)
+                continue;
+
+            size_t component = work->variable_components[owner];
+            if (component == work->variable_components[n] || work->component_reaches_free[component])
+                continue;
+
+            remove_domain_value(supported, value);
+            unsupported = true;
+        }
+
+        // NOTE: The variable's matched value is always supported, so this never leaves it with no values
+        if (unsupported)
+            narrow_variable(propagator, var_index, supported, reason);
+    }
+
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef ALL_DIFFERENT_H
+#define ALL_DIFFERENT_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "arena.h"
+#include "propagate.h"
+
+// All different propagation
+// Each all different constraint keeps a matching of its variables to values, where every variable is matched to a
+// different value in its domain. If no such matching exists, the constraint cannot hold (which catches pigeonhole
+// problems immediately). Otherwise, a value can be removed from a variable's domain if there is no matching in which
+// the variable takes that value (as in Régin's algorithm). This is the case when the value is matched to another
+// variable, and that variable can neither swap values around a cycle that includes the first variable (i.e. they are
+// in different strongly connected components), nor move along a chain of variables that ends at an unmatched value.
+//
+// The matching is kept between revisions (it is not undone when backtracking), as it is usually still mostly valid,
+// and so only the variables whose matched value has been removed need to be matched again.
+
+// AllDifferentWork
+// Space used while revising any all different constraint
+// (Forward declared in "propagate.h", as the propagator owns it)
+struct AllDifferentWork
+{
+    size_t *value_owners;  // The variable each value is matched to
+    size_t *value_parents; // The variable each value was reached from, while searching for an augmenting path
+    size_t *visited_values;
+    size_t *variable_queue;
+
+    // Tarjan's algorithm
+    size_t *variable_orders;
+    size_t *variable_lowlinks;
+    size_t *variable_components;
+    size_t *stack;
+    size_t *call_stack;
+    int *next_values;
+    bool *component_reaches_free;
+};
+
+AllDifferentWork *create_all_different_work(Constraints *constraints, Arena *arena);
+
+// Revising all different constraints
+bool revise_all_different(Propagator *propagator, size_t all_different_index);
+
+#endif
\ No newline at end of file
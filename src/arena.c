@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "arena.h"
+#include "memory.h"
+
+// The block header is padded so that the bytes after it are aligned
+#define BLOCK_HEADER_SIZE (((sizeof(ArenaBlock) + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT) * ARENA_ALIGNMENT)
+
+// Create arena
+Arena *create_arena(size_t block_size)
+{
+    Arena *arena = NEW(Arena);
+    arena->blocks = NULL;
+    arena->block_size = block_size;
+    return arena;
+}
+
+ArenaBlock *create_arena_block(size_t size)
+{
+    ArenaBlock *block = (ArenaBlock *)ALIGNED_ALLOC(uint8_t, ARENA_ALIGNMENT, BLOCK_HEADER_SIZE + size);
+    if (block == NULL)
+    {
+        fprintf(stderr, "Unable to allocate %zu bytes for an arena\n", size);
+        exit(EXIT_FAILURE);
+    }
+
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+// Allocating
+void *arena_alloc(Arena *arena, size_t size)
+{
+    size = ((size + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT) * ARENA_ALIGNMENT;
+
+    ArenaBlock *block = arena->blocks;
+    if (block == NULL || block->used + size > block->size)
+    {
+        // A large allocation goes in a block of its own, behind the current block, so that the rest of the
+        // current block can still be used
+        if (size > arena->block_size / 4 && block != NULL)
+        {
+            ArenaBlock *large = create_arena_block(size);
+            large->used = size;
+            large->next = block->next;
+            block->next = large;
+            return (uint8_t *)large + BLOCK_HEADER_SIZE;
+        }
+
+        block = create_arena_block(size > arena->block_size ? size : arena->block_size);
+        block->next = arena->blocks;
+        arena->blocks = block;
+    }
+
+    void *pointer = (uint8_t *)block + BLOCK_HEADER_SIZE + block->used;
+    block->used += size;
+    return pointer;
+}
+
+void *arena_calloc(Arena *arena, size_t size)
+{
+    void *pointer = arena_alloc(arena, size);
+    memset(pointer, 0, size);
+    return pointer;
+}
+
+// Free arena
+void free_arena(Arena *arena)
+{
+    ArenaBlock *block = arena->blocks;
+    while (block != NULL)
+    {
+        ArenaBlock *next = block->next;
+        ALIGNED_FREE(block);
+        block = next;
+    }
+
+    free(arena);
+}
\ No newline at end of file
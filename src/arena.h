@@ -0,0 +1,42 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// Arena
+// Memory that is allocated by bumping a pointer through large blocks, and is only ever freed all at once. Everything
+// made by one phase of the compiler (e.g. the program's expressions, or the index arrays of every arc) is allocated
+// from the same arena, so that it sits close together in memory and does not need to be freed piece by piece.
+//
+// Allocations larger than a block are given a block of their own.
+typedef struct ArenaBlock ArenaBlock;
+
+struct ArenaBlock
+{
+    ArenaBlock *next;
+    size_t size; // Bytes that can be allocated from the block (which follow the block's header)
+    size_t used;
+};
+
+typedef struct
+{
+    ArenaBlock *blocks; // The block currently being allocated from, followed by every older block
+    size_t block_size;
+} Arena;
+
+// Every allocation is aligned to this many bytes (enough for any type used by the compiler)
+#define ARENA_ALIGNMENT 16
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+#define ARENA_NEW(arena, type) (type *)arena_alloc(arena, sizeof(type))
+#define ARENA_ARRAY(arena, type, count) (type *)arena_alloc(arena, sizeof(type) * (count))
+#define ARENA_ZEROED_ARRAY(arena, type, count) (type *)arena_calloc(arena, sizeof(type) * (count))
+
+Arena *create_arena(size_t block_size);
+void *arena_alloc(Arena *arena, size_t size);
+void *arena_calloc(Arena *arena, size_t size);
+void free_arena(Arena *arena);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,468 @@
+#include <limits.h>
+#include <stdio.h>
+
+#include "bounds.h"
+#include "expression.h"
+
+// Intervals
+// NOTE: Every interval is clamped to the range of an int, as that is what the values of variables are
+//       stored as. Products of two clamped intervals always fit in an int64_t.
+#define TRUE_INTERVAL ((Interval){.min = 1, .max = 1})
+#define FALSE_INTERVAL ((Interval){.min = 0, .max = 0})
+#define MAYBE_INTERVAL ((Interval){.min = 0, .max = 1})
+
+int64_t min_of(int64_t a, int64_t b) { return a < b ? a : b; }
+int64_t max_of(int64_t a, int64_t b) { return a > b ? a : b; }
+
+Interval make_interval(int64_t min, int64_t max)
+{
+    return (Interval){.min = max_of(min, INT_MIN), .max = min_of(max, INT_MAX)};
+}
+
+bool interval_is_empty(Interval interval)
+{
+    return interval.min > interval.max;
+}
+
+bool interval_contains(Interval interval, int64_t value)
+{
+    return value >= interval.min && value <= interval.max;
+}
+
+Interval intersect_intervals(Interval a, Interval b)
+{
+    return (Interval){.min = max_of(a.min, b.min), .max = min_of(a.max, b.max)};
+}
+
+// The smallest interval containing each of the four products (or quotients) of the ends of two intervals
+Interval interval_of_corners(int64_t a, int64_t b, int64_t c, int64_t d)
+{
+    return make_interval(min_of(min_of(a, b), min_of(c, d)), max_of(max_of(a, b), max_of(c, d)));
+}
+
+// Truthiness
+// Any value other than 0 is true, so an interval can only be narrowed to "true" if it is on one side of 0
+bool interval_is_true(Interval interval)
+{
+    return !interval_contains(interval, 0);
+}
+
+bool interval_is_false(Interval interval)
+{
+    return interval.min == 0 && interval.max == 0;
+}
+
+Interval truthy_interval(Interval interval)
+{
+    if (interval.min >= 0)
+        return make_interval(max_of(interval.min, 1), interval.max);
+    if (interval.max <= 0)
+        return make_interval(interval.min, min_of(interval.max, -1));
+
+    return interval;
+}
+
+// Division
+// Integer division truncates towards zero, which is monotonic in each operand as long as the divisor
+// does not change sign. So the divisor is split into its negative and positive parts (skipping 0).
+Interval divide_intervals(Interval lhs, Interval rhs)
+{
+    Interval result = (Interval){.min = INT_MAX, .max = INT_MIN};
+    Interval parts[2] = {
+        intersect_intervals(rhs, (Interval){.min = INT_MIN, .max = -1}),
+        intersect_intervals(rhs, (Interval){.min = 1, .max = INT_MAX}),
+    };
+
+    for (size_t i = 0; i < 2; i++)
+    {
+        Interval part = parts[i];
+        if (interval_is_empty(part))
+            continue;
+
+        Interval quotient = interval_of_corners(lhs.min / part.min, lhs.min / part.max, lhs.max / part.min, lhs.max / part.max);
+        result.min = min_of(result.min, quotient.min);
+        result.max = max_of(result.max, quotient.max);
+    }
+
+    // Dividing by 0 is never valid
+    return result;
+}
+
+// Divide interval exactly
+// Narrow `interval` to the values that, multiplied by some value of `divisor`, give a value in `product`.
+// Dividing by an interval that contains 0 could give any value, so `interval` is left as it is.
+int64_t floor_quotient(int64_t a, int64_t b)
+{
+    int64_t quotient = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? quotient - 1 : quotient;
+}
+
+int64_t ceil_quotient(int64_t a, int64_t b)
+{
+    int64_t quotient = a / b;
+    return (a % b != 0 && (a < 0) == (b < 0)) ? quotient + 1 : quotient;
+}
+
+Interval divide_interval_exactly(Interval product, Interval divisor, Interval interval)
+{
+    if (interval_contains(divisor, 0))
+        return interval;
+
+    int64_t min = min_of(min_of(ceil_quotient(product.min, divisor.min), ceil_quotient(product.min, divisor.max)),
+                         min_of(ceil_quotient(product.max, divisor.min), ceil_quotient(product.max, divisor.max)));
+    int64_t max = max_of(max_of(floor_quotient(product.min, divisor.min), floor_quotient(product.min, divisor.max)),
+                         max_of(floor_quotient(product.max, divisor.min), floor_quotient(product.max, divisor.max)));
+
+    return intersect_intervals(interval, make_interval(min, max));
+}
+
+// Evaluate expression over intervals
+// `variable_intervals` contains the interval of each variable of the arc (before rotation)
+Interval evaluate_interval(Arc *arc, Expression *expr, Interval *variable_intervals)
+{
+    switch (expr->variant)
+    {
+    case EXPR_VARIANT__LITERAL:
+    {
+        if (expr->literal_value.type_primitive == TYPE_PRIMITIVE__NUMBER)
+            return make_interval(expr->literal_value.number, expr->literal_value.number);
+        if (expr->literal_value.type_primitive == TYPE_PRIMITIVE__BOOL)
+            return expr->literal_value.boolean ? TRUE_INTERVAL : FALSE_INTERVAL;
+
+        fprintf(stderr, "Unable to evaluate expression literal\n");
+        print_expression(expr);
+        exit(EXIT_FAILURE);
+    }
+
+    case EXPR_VARIANT__BIN_OP:
+    {
+        Interval lhs = evaluate_interval(arc, expr->lhs, variable_intervals);
+        Interval rhs = evaluate_interval(arc, expr->rhs, variable_intervals);
+
+        if (interval_is_empty(lhs) || interval_is_empty(rhs))
+            return (Interval){.min = 1, .max = 0};
+
+        if (expr->op == OPERATION__MUL)
+            return interval_of_corners(lhs.min * rhs.min, lhs.min * rhs.max, lhs.max * rhs.min, lhs.max * rhs.max);
+        if (expr->op == OPERATION__DIV)
+            return divide_intervals(lhs, rhs);
+        if (expr->op == OPERATION__ADD)
+            return make_interval(lhs.min + rhs.min, lhs.max + rhs.max);
+        if (expr->op == OPERATION__SUB)
+            return make_interval(lhs.min - rhs.max, lhs.max - rhs.min);
+
+        if (expr->op == OPERATION__LESS_THAN)
+            return lhs.max < rhs.min ? TRUE_INTERVAL : lhs.min >= rhs.max ? FALSE_INTERVAL : MAYBE_INTERVAL;
+        if (expr->op == OPERATION__MORE_THAN)
+            return lhs.min > rhs.max ? TRUE_INTERVAL : lhs.max <= rhs.min ? FALSE_INTERVAL : MAYBE_INTERVAL;
+        if (expr->op == OPERATION__LESS_THAN_OR_EQUAL)
+            return lhs.max <= rhs.min ? TRUE_INTERVAL : lhs.min > rhs.max ? FALSE_INTERVAL : MAYBE_INTERVAL;
+        if (expr->op == OPERATION__MORE_THAN_OR_EQUAL)
+            return lhs.min >= rhs.max ? TRUE_INTERVAL : lhs.max < rhs.min ? FALSE_INTERVAL : MAYBE_INTERVAL;
+
+        if (expr->op == OPERATION__EQUAL_TO || expr->op == OPERATION__NOT_EQUAL_TO)
+        {
+            bool equal = lhs.min == lhs.max && rhs.min == rhs.max && lhs.min == rhs.min;
+            bool not_equal = interval_is_empty(intersect_intervals(lhs, rhs));
+
+            if (expr->op == OPERATION__NOT_EQUAL_TO)
+            {
+                bool swap = equal;
+                equal = not_equal;
+                not_equal = swap;
+            }
+
+            return equal ? TRUE_INTERVAL : not_equal ? FALSE_INTERVAL : MAYBE_INTERVAL;
+        }
+
+        if (expr->op == OPERATION__LOGICAL_AND)
+        {
+            if (interval_is_false(lhs) || interval_is_false(rhs))
+                return FALSE_INTERVAL;
+            return interval_is_true(lhs) && interval_is_true(rhs) ? TRUE_INTERVAL : MAYBE_INTERVAL;
+        }
+
+        if (expr->op == OPERATION__LOGICAL_OR)
+        {
+            if (interval_is_true(lhs) || interval_is_true(rhs))
+                return TRUE_INTERVAL;
+            return interval_is_false(lhs) && interval_is_false(rhs) ? FALSE_INTERVAL : MAYBE_INTERVAL;
+        }
+
+        fprintf(stderr, "Unable to evaluate %s binary operation\n", operation_string(expr->op));
+        print_expression(expr);
+        exit(EXIT_FAILURE);
+    }
+
+    case EXPR_VARIANT__VARIABLE_REFERENCE_INDEX:
+    {
+        size_t index = (expr->variable_reference_index + arc->expr_rotation) % arc->variable_indexes_count;
+        return variable_intervals[index];
+    }
+
+    case EXPR_VARIANT__INSTANCE_REFERENCE_INDEX:
+    {
+        size_t instance = arc->instance_indexes[expr->instance_reference_index];
+        return make_interval(instance, instance);
+    }
+
+    default:
+    {
+        fprintf(stderr, "Unable to evaluate %s expression\n", expr_variant_string(expr->variant));
+        print_expression(expr);
+        exit(EXIT_FAILURE);
+    }
+    }
+}
+
+// Project interval
+// Narrow the interval of the primary variable (`variable_intervals[0]`) to the values that could make
+// `expr` evaluate to a value in `target`. Returns false if `expr` cannot evaluate to a value in `target`.
+bool project_interval(Arc *arc, Expression *expr, Interval target, Interval *variable_intervals);
+
+// Project a relation between the two sides of a comparison that is known to hold
+bool project_relation(Arc *arc, Expression *expr, Operation op, Interval lhs, Interval rhs, Interval *variable_intervals)
+{
+    Interval lhs_target = lhs;
+    Interval rhs_target = rhs;
+
+    if (op == OPERATION__LESS_THAN)
+    {
+        lhs_target = make_interval(lhs.min, min_of(lhs.max, rhs.max - 1));
+        rhs_target = make_interval(max_of(rhs.min, lhs.min + 1), rhs.max);
+    }
+    else if (op == OPERATION__LESS_THAN_OR_EQUAL)
+    {
+        lhs_target = make_interval(lhs.min, min_of(lhs.max, rhs.max));
+        rhs_target = make_interval(max_of(rhs.min, lhs.min), rhs.max);
+    }
+    else if (op == OPERATION__MORE_THAN)
+    {
+        lhs_target = make_interval(max_of(lhs.min, rhs.min + 1), lhs.max);
+        rhs_target = make_interval(rhs.min, min_of(rhs.max, lhs.max - 1));
+    }
+    else if (op == OPERATION__MORE_THAN_OR_EQUAL)
+    {
+        lhs_target = make_interval(max_of(lhs.min, rhs.min), lhs.max);
+        rhs_target = make_interval(rhs.min, min_of(rhs.max, lhs.max));
+    }
+    else if (op == OPERATION__EQUAL_TO)
+    {
+        lhs_target = intersect_intervals(lhs, rhs);
+        rhs_target = lhs_target;
+    }
+    else if (op == OPERATION__NOT_EQUAL_TO)
+    {
+        // A value can only be removed from the end of an interval, if the other side has exactly that value
+        if (rhs.min == rhs.max && lhs.min == rhs.min)
+            lhs_target.min++;
+        else if (rhs.min == rhs.max && lhs.max == rhs.min)
+            lhs_target.max--;
+
+        if (lhs.min == lhs.max && rhs.min == lhs.min)
+            rhs_target.min++;
+        else if (lhs.min == lhs.max && rhs.max == lhs.min)
+            rhs_target.max--;
+    }
+
+    return project_interval(arc, expr->lhs, lhs_target, variable_intervals) &&
+           project_interval(arc, expr->rhs, rhs_target, variable_intervals);
+}
+
+// The operation that holds whenever a comparison does not
+Operation negate_comparison(Operation op)
+{
+    switch (op)
+    {
+    case OPERATION__LESS_THAN:
+        return OPERATION__MORE_THAN_OR_EQUAL;
+    case OPERATION__MORE_THAN:
+        return OPERATION__LESS_THAN_OR_EQUAL;
+    case OPERATION__LESS_THAN_OR_EQUAL:
+        return OPERATION__MORE_THAN;
+    case OPERATION__MORE_THAN_OR_EQUAL:
+        return OPERATION__LESS_THAN;
+    case OPERATION__EQUAL_TO:
+        return OPERATION__NOT_EQUAL_TO;
+    case OPERATION__NOT_EQUAL_TO:
+        return OPERATION__EQUAL_TO;
+    default:
+        return op;
+    }
+}
+
+bool project_interval(Arc *arc, Expression *expr, Interval target, Interval *variable_intervals)
+{
+    Interval value = intersect_intervals(evaluate_interval(arc, expr, variable_intervals), target);
+    if (interval_is_empty(value))
+        return false;
+
+    switch (expr->variant)
+    {
+    case EXPR_VARIANT__VARIABLE_REFERENCE_INDEX:
+    {
+        size_t index = (expr->variable_reference_index + arc->expr_rotation) % arc->variable_indexes_count;
+        if (index == 0)
+            variable_intervals[0] = value;
+        return true;
+    }
+
+    case EXPR_VARIANT__BIN_OP:
+    {
+        Interval lhs = evaluate_interval(arc, expr->lhs, variable_intervals);
+        Interval rhs = evaluate_interval(arc, expr->rhs, variable_intervals);
+        Operation op = expr->op;
+
+        // Arithmetic
+        // Each side is narrowed to the values that, combined with some value of the other side, give a value in `value`
+        if (op == OPERATION__ADD)
+            return project_interval(arc, expr->lhs, make_interval(value.min - rhs.max, value.max - rhs.min), variable_intervals) &&
+                   project_interval(arc, expr->rhs, make_interval(value.min - lhs.max, value.max - lhs.min), variable_intervals);
+
+        if (op == OPERATION__SUB)
+            return project_interval(arc, expr->lhs, make_interval(value.min + rhs.min, value.max + rhs.max), variable_intervals) &&
+                   project_interval(arc, expr->rhs, make_interval(lhs.min - value.max, lhs.max - value.min), variable_intervals);
+
+        if (op == OPERATION__MUL)
+            return project_interval(arc, expr->lhs, divide_interval_exactly(value, rhs, lhs), variable_intervals) &&
+                   project_interval(arc, expr->rhs, divide_interval_exactly(value, lhs, rhs), variable_intervals);
+
+        if (op == OPERATION__DIV)
+        {
+            // NOTE: This is only done when both sides are positive, as that is where rounding is simple
+            Interval lhs_target = lhs;
+            if (lhs.min >= 0 && rhs.min > 0)
+                lhs_target = make_interval(max_of(value.min, 0) * rhs.min, value.max * rhs.max + rhs.max - 1);
+
+            return project_interval(arc, expr->lhs, lhs_target, variable_intervals) &&
+                   project_interval(arc, expr->rhs, rhs, variable_intervals);
+        }
+
+        // Comparisons
+        if (op == OPERATION__LESS_THAN || op == OPERATION__MORE_THAN ||
+            op == OPERATION__LESS_THAN_OR_EQUAL || op == OPERATION__MORE_THAN_OR_EQUAL ||
+            op == OPERATION__EQUAL_TO || op == OPERATION__NOT_EQUAL_TO)
+        {
+            if (interval_is_true(value))
+                return project_relation(arc, expr, op, lhs, rhs, variable_intervals);
+            if (interval_is_false(value))
+                return project_relation(arc, expr, negate_comparison(op), lhs, rhs, variable_intervals);
+
+            return true;
+        }
+
+        // Logical operations
+        if (op == OPERATION__LOGICAL_AND && interval_is_true(value))
+            return project_interval(arc, expr->lhs, truthy_interval(lhs), variable_intervals) &&
+                   project_interval(arc, expr->rhs, truthy_interval(rhs), variable_intervals);
+
+        if (op == OPERATION__LOGICAL_AND && interval_is_false(value))
+        {
+            if (interval_is_true(lhs))
+                return project_interval(arc, expr->rhs, FALSE_INTERVAL, variable_intervals);
+            if (interval_is_true(rhs))
+                return project_interval(arc, expr->lhs, FALSE_INTERVAL, variable_intervals);
+
+            return true;
+        }
+
+        if (op == OPERATION__LOGICAL_OR && interval_is_true(value))
+        {
+            if (interval_is_false(lhs))
+                return project_interval(arc, expr->rhs, truthy_interval(rhs), variable_intervals);
+            if (interval_is_false(rhs))
+                return project_interval(arc, expr->lhs, truthy_interval(lhs), variable_intervals);
+
+            return true;
+        }
+
+        if (op == OPERATION__LOGICAL_OR && interval_is_false(value))
+            return project_interval(arc, expr->lhs, FALSE_INTERVAL, variable_intervals) &&
+                   project_interval(arc, expr->rhs, FALSE_INTERVAL, variable_intervals);
+
+        return true;
+    }
+
+    default:
+        return true;
+    }
+}
+
+// Project the arc's expression onto the primary variable, given that the expression must be true
+bool project_arc(Arc *arc, Interval *variable_intervals)
+{
+    Interval value = evaluate_interval(arc, arc->expr, variable_intervals);
+    if (interval_is_empty(value) || interval_is_false(value))
+        return false;
+
+    return project_interval(arc, arc->expr, truthy_interval(value), variable_intervals);
+}
+
+// Revising arcs
+bool arc_has_bounds_variable(QuantumMap *quantum_map, Arc *arc)
+{
+    for (size_t n = 0; n < arc->variable_indexes_count; n++)
+        if (quantum_map->variables[arc->variable_indexes[n]].kind == DOMAIN_KIND__BOUNDS)
+            return true;
+
+    return false;
+}
+
+// TODO: Support for more than a fixed number of variables.
+#define MAX_BOUNDS_VARIABLES 16
+
+// Revise arc bounds
+// Narrow the domain of the arc's primary variable to the values that are supported by the intervals of
+// the arc's other variables. If the primary variable is a bitfield, each of its values is tested on its
+// own (as it is usually small), otherwise its interval is narrowed as a whole.
+bool revise_arc_bounds(Propagator *propagator, Arc *arc, Reason reason)
+{
+    QuantumMap *quantum_map = propagator->quantum_map;
+    size_t primary_index = arc->variable_indexes[0];
+
+    if (arc->variable_indexes_count > MAX_BOUNDS_VARIABLES)
+    {
+        fprintf(stderr, "Internal error: We are currently unable to enforce arcs that constrain more than %d variables.", MAX_BOUNDS_VARIABLES);
+        exit(EXIT_FAILURE);
+    }
+
+    Interval variable_intervals[MAX_BOUNDS_VARIABLES];
+    for (size_t n = 0; n < arc->variable_indexes_count; n++)
+    {
+        Domain domain = get_domain(quantum_map, arc->variable_indexes[n]);
+        if (domain_is_empty(domain))
+            variable_intervals[n] = (Interval){.min = 1, .max = 0};
+        else
+            variable_intervals[n] = make_interval(first_domain_value(domain), last_domain_value(domain));
+    }
+
+    Domain primary_domain = get_domain(quantum_map, primary_index);
+    Domain supported = scratch_domain(propagator, primary_index);
+    clear_domain(supported);
+
+    if (primary_domain.kind == DOMAIN_KIND__BITFIELD)
+    {
+        for (int value = first_domain_value(primary_domain); value != NO_VALUE; value = domain_value_after(primary_domain, value))
+        {
+            variable_intervals[0] = make_interval(value, value);
+            if (project_arc(arc, variable_intervals))
+                add_domain_value(supported, value);
+        }
+    }
+
+    else if (!interval_is_empty(variable_intervals[0]))
+    {
+        bool was_single_value = variable_intervals[0].min == variable_intervals[0].max;
+        bool is_supported = project_arc(arc, variable_intervals);
+
+        // NOTE: Projecting can narrow the interval to a single value that was never tested on its own (e.g. because
+        //       `x / y` rounds), so that value is projected again, which evaluates it exactly
+        if (is_supported && !was_single_value && variable_intervals[0].min == variable_intervals[0].max)
+            is_supported = project_arc(arc, variable_intervals);
+
+        if (is_supported)
+            set_domain_bounds(supported, variable_intervals[0].min, variable_intervals[0].max);
+    }
+
+    return narrow_variable(propagator, primary_index, supported, reason);
+}
@@ -0,0 +1,29 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "propagate.h"
+
+// Bounds propagation
+// Arcs that constrain a variable with a bounds domain have too many combinations of values to test
+// one at a time. Instead, the arc's expression is evaluated over intervals (the smallest and largest
+// value each variable could take), and then the interval the expression must be in for the arc to hold
+// is projected back down the expression onto the arc's primary variable (as in HC4). Each revision
+// costs time proportional to the size of the expression, regardless of how large the domains are.
+// This is weaker than testing every combination (e.g. it cannot remove a value from the middle of a
+// range), but never removes a value that is supported.
+
+// Interval
+typedef struct
+{
+    int64_t min;
+    int64_t max;
+} Interval;
+
+// Revising arcs
+bool arc_has_bounds_variable(QuantumMap *quantum_map, Arc *arc);
+bool revise_arc_bounds(Propagator *propagator, Arc *arc, Reason reason);
+
+#endif
\ No newline at end of file
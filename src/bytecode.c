@@ -0,0 +1,665 @@
+#include <stdio.h>
+
+#include "bytecode.h"
+#include "memory.h"
+
+// Operand
+// While compiling, the number of constants and temporaries is not yet known, so operands are kept
+// relative to the start of their section of registers until the whole expression has been compiled
+typedef enum
+{
+    OPERAND_KIND__FIXED, // A variable or instance register, which is already known
+    OPERAND_KIND__CONSTANT,
+    OPERAND_KIND__TEMPORARY,
+} OperandKind;
+
+typedef struct
+{
+    OperandKind kind;
+    size_t index;
+} Operand;
+
+typedef struct
+{
+    Operation op;
+    Operand result;
+    Operand lhs;
+    Operand rhs;
+} PendingInstruction;
+
+typedef struct
+{
+    MaskInstruction instruction;
+    Operand operand;
+} PendingMaskInstruction;
+
+// Compiler
+typedef struct
+{
+    Bytecode *bytecode;
+    size_t rotation;
+
+    PendingInstruction *instructions;
+    size_t instructions_count;
+    size_t instructions_capacity;
+
+    PendingMaskInstruction *mask_instructions;
+    size_t mask_instructions_count;
+    size_t mask_instructions_capacity;
+
+    size_t temporaries_count;     // The number of temporary registers currently in use
+    size_t max_temporaries_count; // The most temporary registers that were ever in use at once
+} Compiler;
+
+// Returns the constant operand for the value, adding it to the constants if it has not been used before
+Operand constant_operand(Bytecode *bytecode, int value)
+{
+    for (size_t c = 0; c < bytecode->constants_count; c++)
+        if (bytecode->constants[c] == value)
+            return (Operand){.kind = OPERAND_KIND__CONSTANT, .index = c};
+
+    *EXTEND_ARRAY(bytecode->constants, int) = value;
+    return (Operand){.kind = OPERAND_KIND__CONSTANT, .index = bytecode->constants_count - 1};
+}
+
+size_t operand_register(Bytecode *bytecode, Operand operand)
+{
+    size_t first_constant = bytecode->variables_count + bytecode->instances_count;
+
+    if (operand.kind == OPERAND_KIND__CONSTANT)
+        return first_constant + operand.index;
+    if (operand.kind == OPERAND_KIND__TEMPORARY)
+        return first_constant + bytecode->constants_count + operand.index;
+
+    return operand.index;
+}
+
+// Apply operation
+// NOTE: This must match `run_bytecode`
+bool apply_operation(Operation op, int lhs, int rhs, int *result)
+{
+    switch (op)
+    {
+    case OPERATION__MUL:
+        *result = lhs * rhs;
+        return true;
+    case OPERATION__DIV:
+        if (rhs == 0)
+            return false;
+        *result = lhs / rhs;
+        return true;
+    case OPERATION__ADD:
+        *result = lhs + rhs;
+        return true;
+    case OPERATION__SUB:
+        *result = lhs - rhs;
+        return true;
+    case OPERATION__LESS_THAN:
+        *result = lhs < rhs;
+        return true;
+    case OPERATION__MORE_THAN:
+        *result = lhs > rhs;
+        return true;
+    case OPERATION__LESS_THAN_OR_EQUAL:
+        *result = lhs <= rhs;
+        return true;
+    case OPERATION__MORE_THAN_OR_EQUAL:
+        *result = lhs >= rhs;
+        return true;
+    case OPERATION__EQUAL_TO:
+        *result = lhs == rhs;
+        return true;
+    case OPERATION__NOT_EQUAL_TO:
+        *result = lhs != rhs;
+        return true;
+    case OPERATION__LOGICAL_AND:
+        *result = lhs && rhs;
+        return true;
+    case OPERATION__LOGICAL_OR:
+        *result = lhs || rhs;
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Compile expression
+// Returns the operand that will hold the value of the expression. Operations on two constants are
+// folded into a single constant. Temporary registers are allocated like a stack (so an expression
+// needs as many as its deepest chain of operations).
+Operand compile(Compiler *compiler, Expression *expr)
+{
+    Bytecode *bytecode = compiler->bytecode;
+
+    switch (expr->variant)
+    {
+    case EXPR_VARIANT__LITERAL:
+    {
+        if (expr->literal_value.type_primitive == TYPE_PRIMITIVE__NUMBER)
+            return constant_operand(bytecode, expr->literal_value.number);
+        if (expr->literal_value.type_primitive == TYPE_PRIMITIVE__BOOL)
+            return constant_operand(bytecode, expr->literal_value.boolean ? 1 : 0);
+
+        fprintf(stderr, "Unable to compile expression literal\n");
+        print_expression(expr);
+        exit(EXIT_FAILURE);
+    }
+
+    case EXPR_VARIANT__VARIABLE_REFERENCE_INDEX:
+    {
+        size_t index = (expr->variable_reference_index + compiler->rotation) % bytecode->variables_count;
+        return (Operand){.kind = OPERAND_KIND__FIXED, .index = index};
+    }
+
+    case EXPR_VARIANT__INSTANCE_REFERENCE_INDEX:
+        return (Operand){.kind = OPERAND_KIND__FIXED, .index = bytecode->variables_count + expr->instance_reference_index};
+
+    case EXPR_VARIANT__BIN_OP:
+    {
+        size_t temporaries_count = compiler->temporaries_count;
+        Operand lhs = compile(compiler, expr->lhs);
+        Operand rhs = compile(compiler, expr->rhs);
+
+        // Fold operations on constants
+        int folded;
+        if (lhs.kind == OPERAND_KIND__CONSTANT && rhs.kind == OPERAND_KIND__CONSTANT &&
+            apply_operation(expr->op, bytecode->constants[lhs.index], bytecode->constants[rhs.index], &folded))
+        {
+            compiler->temporaries_count = temporaries_count;
+            return constant_operand(bytecode, folded);
+        }
+
+        // The operands' temporaries are no longer needed once this instruction has run, so the result can reuse the first of them
+        Operand result = (Operand){.kind = OPERAND_KIND__TEMPORARY, .index = temporaries_count};
+        compiler->temporaries_count = temporaries_count + 1;
+        if (compiler->temporaries_count > compiler->max_temporaries_count)
+            compiler->max_temporaries_count = compiler->temporaries_count;
+
+        PendingInstruction *instruction = EXTEND_ARRAY(compiler->instructions, PendingInstruction);
+        instruction->op = expr->op;
+        instruction->result = result;
+        instruction->lhs = lhs;
+        instruction->rhs = rhs;
+
+        return result;
+    }
+
+    default:
+    {
+        fprintf(stderr, "Unable to compile %s expression\n", expr_variant_string(expr->variant));
+        print_expression(expr);
+        exit(EXIT_FAILURE);
+    }
+    }
+}
+
+Compiler create_compiler(size_t rotation, size_t variables_count, size_t instances_count)
+{
+    Bytecode *bytecode = NEW(Bytecode);
+    INIT_ARRAY(bytecode->constants);
+    bytecode->variables_count = variables_count;
+    bytecode->instances_count = instances_count;
+
+    Compiler compiler;
+    compiler.bytecode = bytecode;
+    compiler.rotation = rotation;
+    INIT_ARRAY(compiler.instructions);
+    INIT_ARRAY(compiler.mask_instructions);
+    compiler.temporaries_count = 0;
+    compiler.max_temporaries_count = 0;
+    return compiler;
+}
+
+// Now that every constant is known, give each operand its register
+Bytecode *finish_bytecode(Compiler *compiler, Operand result)
+{
+    Bytecode *bytecode = compiler->bytecode;
+
+    bytecode->registers_count = bytecode->variables_count + bytecode->instances_count + bytecode->constants_count + compiler->max_temporaries_count;
+    if (bytecode->registers_count > MAX_REGISTERS)
+    {
+        fprintf(stderr, "Internal error: We are currently unable to compile arcs that need more than %d registers.", MAX_REGISTERS);
+        exit(EXIT_FAILURE);
+    }
+
+    bytecode->instructions_count = compiler->instructions_count;
+    bytecode->instructions = (Instruction *)malloc(sizeof(Instruction) * (compiler->instructions_count + 1));
+    for (size_t i = 0; i < compiler->instructions_count; i++)
+    {
+        PendingInstruction *pending = compiler->instructions + i;
+        Instruction *instruction = bytecode->instructions + i;
+        instruction->op = pending->op;
+        instruction->result = (uint16_t)operand_register(bytecode, pending->result);
+        instruction->lhs = (uint16_t)operand_register(bytecode, pending->lhs);
+        instruction->rhs = (uint16_t)operand_register(bytecode, pending->rhs);
+    }
+
+    bytecode->result_register = operand_register(bytecode, result);
+
+    free(compiler->instructions);
+    return bytecode;
+}
+
+Bytecode *compile_expression(Expression *expr, size_t rotation, size_t variables_count, size_t instances_count)
+{
+    Compiler compiler = create_compiler(rotation, variables_count, instances_count);
+    Operand result = compile(&compiler, expr);
+    return finish_bytecode(&compiler, result);
+}
+
+// Compile mask expression
+bool reads_primary(Compiler *compiler, Expression *expr)
+{
+    if (expr->variant == EXPR_VARIANT__VARIABLE_REFERENCE_INDEX)
+        return (expr->variable_reference_index + compiler->rotation) % compiler->bytecode->variables_count == 0;
+    if (expr->variant == EXPR_VARIANT__BIN_OP)
+        return reads_primary(compiler, expr->lhs) || reads_primary(compiler, expr->rhs);
+
+    return false;
+}
+
+bool is_number_literal(Expression *expr)
+{
+    return expr->variant == EXPR_VARIANT__LITERAL && expr->literal_value.type_primitive == TYPE_PRIMITIVE__NUMBER;
+}
+
+bool is_primary(Compiler *compiler, Expression *expr)
+{
+    return expr->variant == EXPR_VARIANT__VARIABLE_REFERENCE_INDEX && reads_primary(compiler, expr);
+}
+
+// Returns true if the expression is `primary`, `primary + k`, `k + primary` or `primary - k` (where
+// `k` is a number literal), storing `k` (or `-k`) in `offset`
+bool is_primary_term(Compiler *compiler, Expression *expr, int *offset)
+{
+    if (is_primary(compiler, expr))
+    {
+        *offset = 0;
+        return true;
+    }
+
+    if (expr->variant != EXPR_VARIANT__BIN_OP)
+        return false;
+
+    if (expr->op == OPERATION__ADD && is_primary(compiler, expr->lhs) && is_number_literal(expr->rhs))
+        *offset = expr->rhs->literal_value.number;
+    else if (expr->op == OPERATION__ADD && is_number_literal(expr->lhs) && is_primary(compiler, expr->rhs))
+        *offset = expr->lhs->literal_value.number;
+    else if (expr->op == OPERATION__SUB && is_primary(compiler, expr->lhs) && is_number_literal(expr->rhs))
+        *offset = -expr->rhs->literal_value.number;
+    else
+        return false;
+
+    return true;
+}
+
+bool is_comparison(Operation op)
+{
+    return op == OPERATION__LESS_THAN || op == OPERATION__MORE_THAN ||
+           op == OPERATION__LESS_THAN_OR_EQUAL || op == OPERATION__MORE_THAN_OR_EQUAL ||
+           op == OPERATION__EQUAL_TO || op == OPERATION__NOT_EQUAL_TO;
+}
+
+// The comparison that holds with its sides swapped (e.g. `a < b` is `b > a`)
+Operation mirror_comparison(Operation op)
+{
+    if (op == OPERATION__LESS_THAN)
+        return OPERATION__MORE_THAN;
+    if (op == OPERATION__MORE_THAN)
+        return OPERATION__LESS_THAN;
+    if (op == OPERATION__LESS_THAN_OR_EQUAL)
+        return OPERATION__MORE_THAN_OR_EQUAL;
+    if (op == OPERATION__MORE_THAN_OR_EQUAL)
+        return OPERATION__LESS_THAN_OR_EQUAL;
+
+    return op;
+}
+
+// Returns true if the expression always evaluates to 0 or 1
+bool is_boolean(Expression *expr)
+{
+    if (expr->variant == EXPR_VARIANT__BIN_OP)
+        return is_comparison(expr->op) || expr->op == OPERATION__LOGICAL_AND || expr->op == OPERATION__LOGICAL_OR;
+
+    return false;
+}
+
+size_t emit_mask_instruction(Compiler *compiler, MaskInstruction instruction, Operand operand)
+{
+    instruction.result = (uint16_t)compiler->mask_instructions_count;
+
+    PendingMaskInstruction *pending = EXTEND_ARRAY(compiler->mask_instructions, PendingMaskInstruction);
+    pending->instruction = instruction;
+    pending->operand = operand;
+
+    return instruction.result;
+}
+
+// Compile mask
+// Stores the mask that will hold the values of the primary variable for which `expr` is true in `mask`.
+// Returns false if the expression cannot be compiled to exact masks.
+// NOTE: The operands of mask instructions are kept in temporaries that are never reused (`compile`
+//       only ever reuses temporaries above the ones in use when it is called), as every ordinary
+//       instruction is run before any mask instruction.
+bool compile_mask(Compiler *compiler, Expression *expr, size_t *mask)
+{
+    Operand none = (Operand){.kind = OPERAND_KIND__FIXED, .index = 0};
+
+    // The expression does not depend on the primary variable, so it is either true for every value or for none
+    if (!reads_primary(compiler, expr))
+    {
+        Operand operand = compile(compiler, expr);
+        *mask = emit_mask_instruction(compiler, (MaskInstruction){.mask_op = MASK_OP__TRUTH}, operand);
+        return true;
+    }
+
+    // `primary` (or `primary + k`) on its own is true for every value but `-k`
+    int offset;
+    if (is_primary_term(compiler, expr, &offset))
+    {
+        Operand zero = constant_operand(compiler->bytecode, 0);
+        *mask = emit_mask_instruction(compiler, (MaskInstruction){.mask_op = MASK_OP__COMPARE, .op = OPERATION__NOT_EQUAL_TO, .offset = offset}, zero);
+        return true;
+    }
+
+    if (expr->variant != EXPR_VARIANT__BIN_OP)
+        return false;
+
+    if (expr->op == OPERATION__LOGICAL_AND || expr->op == OPERATION__LOGICAL_OR)
+    {
+        size_t lhs, rhs;
+        if (!compile_mask(compiler, expr->lhs, &lhs) || !compile_mask(compiler, expr->rhs, &rhs))
+            return false;
+
+        MaskOp mask_op = expr->op == OPERATION__LOGICAL_AND ? MASK_OP__AND : MASK_OP__OR;
+        *mask = emit_mask_instruction(compiler, (MaskInstruction){.mask_op = mask_op, .lhs = (uint16_t)lhs, .rhs = (uint16_t)rhs}, none);
+        return true;
+    }
+
+    if (!is_comparison(expr->op))
+        return false;
+
+    // Make sure the side that reads the primary variable is on the left
+    Operation op = expr->op;
+    Expression *lhs = expr->lhs;
+    Expression *rhs = expr->rhs;
+    if (reads_primary(compiler, rhs))
+    {
+        if (reads_primary(compiler, lhs))
+            return false;
+
+        op = mirror_comparison(op);
+        lhs = expr->rhs;
+        rhs = expr->lhs;
+    }
+
+    // `primary + k <op> rhs`
+    if (is_primary_term(compiler, lhs, &offset))
+    {
+        Operand operand = compile(compiler, rhs);
+        *mask = emit_mask_instruction(compiler, (MaskInstruction){.mask_op = MASK_OP__COMPARE, .op = op, .offset = offset}, operand);
+        return true;
+    }
+
+    // `(a boolean expression that reads the primary variable) = rhs`
+    if ((op == OPERATION__EQUAL_TO || op == OPERATION__NOT_EQUAL_TO) && is_boolean(lhs))
+    {
+        size_t boolean_mask;
+        if (!compile_mask(compiler, lhs, &boolean_mask))
+            return false;
+
+        Operand operand = compile(compiler, rhs);
+        *mask = emit_mask_instruction(compiler, (MaskInstruction){.mask_op = MASK_OP__SELECT, .op = op, .lhs = (uint16_t)boolean_mask}, operand);
+        return true;
+    }
+
+    return false;
+}
+
+MaskBytecode *compile_mask_expression(Expression *expr, size_t rotation, size_t variables_count, size_t instances_count)
+{
+    Compiler compiler = create_compiler(rotation, variables_count, instances_count);
+
+    size_t result_mask;
+    if (!compile_mask(&compiler, expr, &result_mask) || compiler.mask_instructions_count > MAX_MASKS)
+    {
+        free(compiler.instructions);
+        free(compiler.mask_instructions);
+        free(compiler.bytecode->constants);
+        free(compiler.bytecode);
+        return NULL;
+    }
+
+    MaskBytecode *mask_bytecode = NEW(MaskBytecode);
+    mask_bytecode->bytecode = finish_bytecode(&compiler, (Operand){.kind = OPERAND_KIND__FIXED, .index = 0});
+    mask_bytecode->masks_count = compiler.mask_instructions_count;
+    mask_bytecode->result_mask = result_mask;
+
+    mask_bytecode->instructions_count = compiler.mask_instructions_count;
+    mask_bytecode->instructions = (MaskInstruction *)malloc(sizeof(MaskInstruction) * (compiler.mask_instructions_count + 1));
+    for (size_t i = 0; i < compiler.mask_instructions_count; i++)
+    {
+        PendingMaskInstruction *pending = compiler.mask_instructions + i;
+        mask_bytecode->instructions[i] = pending->instruction;
+        mask_bytecode->instructions[i].operand = (uint16_t)operand_register(mask_bytecode->bytecode, pending->operand);
+    }
+
+    free(compiler.mask_instructions);
+    return mask_bytecode;
+}
+
+// Querying
+bool bytecode_reads_instances(Bytecode *bytecode)
+{
+    size_t first_instance = bytecode->variables_count;
+    size_t end_instance = first_instance + bytecode->instances_count;
+
+    for (size_t i = 0; i < bytecode->instructions_count; i++)
+    {
+        Instruction *instruction = bytecode->instructions + i;
+        if ((instruction->lhs >= first_instance && instruction->lhs < end_instance) ||
+            (instruction->rhs >= first_instance && instruction->rhs < end_instance))
+            return true;
+    }
+
+    return bytecode->result_register >= first_instance && bytecode->result_register < end_instance;
+}
+
+// Running
+// Write the arc's instances and the constants into their registers. This only needs to be done once
+// for each arc, as only the variable registers change between runs.
+void prepare_registers(Bytecode *bytecode, int *registers, size_t *instance_indexes)
+{
+    int *instances = registers + bytecode->variables_count;
+    for (size_t i = 0; i < bytecode->instances_count; i++)
+        instances[i] = (int)instance_indexes[i];
+
+    int *constants = instances + bytecode->instances_count;
+    for (size_t c = 0; c < bytecode->constants_count; c++)
+        constants[c] = bytecode->constants[c];
+}
+
+// Run every instruction, returning false if one of them divides by 0
+// NOTE: Dividing by 0 leaves the whole expression without a value, which `evaluate_interval` treats as never true
+bool run_instructions(Bytecode *bytecode, int *registers)
+{
+    Instruction *instruction = bytecode->instructions;
+    Instruction *end = instruction + bytecode->instructions_count;
+
+    for (; instruction < end; instruction++)
+    {
+        int lhs = registers[instruction->lhs];
+        int rhs = registers[instruction->rhs];
+        int result;
+
+        switch (instruction->op)
+        {
+        case OPERATION__MUL:
+            result = lhs * rhs;
+            break;
+        case OPERATION__DIV:
+            if (rhs == 0)
+                return false;
+            result = lhs / rhs;
+            break;
+        case OPERATION__ADD:
+            result = lhs + rhs;
+            break;
+        case OPERATION__SUB:
+            result = lhs - rhs;
+            break;
+        case OPERATION__LESS_THAN:
+            result = lhs < rhs;
+            break;
+        case OPERATION__MORE_THAN:
+            result = lhs > rhs;
+            break;
+        case OPERATION__LESS_THAN_OR_EQUAL:
+            result = lhs <= rhs;
+            break;
+        case OPERATION__MORE_THAN_OR_EQUAL:
+            result = lhs >= rhs;
+            break;
+        case OPERATION__EQUAL_TO:
+            result = lhs == rhs;
+            break;
+        case OPERATION__NOT_EQUAL_TO:
+            result = lhs != rhs;
+            break;
+        case OPERATION__LOGICAL_AND:
+            result = lhs && rhs;
+            break;
+        case OPERATION__LOGICAL_OR:
+            result = lhs || rhs;
+            break;
+        default:
+            fprintf(stderr, "Unable to run %s instruction\n", operation_string(instruction->op));
+            exit(EXIT_FAILURE);
+        }
+
+        registers[instruction->result] = result;
+    }
+
+    return true;
+}
+
+int run_bytecode(Bytecode *bytecode, int *registers)
+{
+    if (!run_instructions(bytecode, registers))
+        return 0;
+
+    return registers[bytecode->result_register];
+}
+
+// Run mask bytecode
+// Every ordinary instruction is run first, and then every mask instruction. Each mask must have the same
+// shape as the primary variable's domain. Bits past the end of the primary variable's domain may be set
+// in the resulting mask, so it should be intersected with the primary variable's domain.
+void run_mask_bytecode(MaskBytecode *mask_bytecode, int *registers, Domain *masks)
+{
+    // No value of the primary variable is supported if the other variables' values divide by 0
+    if (!run_instructions(mask_bytecode->bytecode, registers))
+    {
+        clear_domain(masks[mask_bytecode->result_mask]);
+        return;
+    }
+
+    for (size_t i = 0; i < mask_bytecode->instructions_count; i++)
+    {
+        MaskInstruction *instruction = mask_bytecode->instructions + i;
+        Domain result = masks[instruction->result];
+        int64_t value = registers[instruction->operand];
+
+        switch (instruction->mask_op)
+        {
+        case MASK_OP__COMPARE:
+        {
+            int64_t c = value - instruction->offset;
+            switch (instruction->op)
+            {
+            case OPERATION__LESS_THAN:
+                set_domain_range(result, INT64_MIN, c - 1);
+                break;
+            case OPERATION__LESS_THAN_OR_EQUAL:
+                set_domain_range(result, INT64_MIN, c);
+                break;
+            case OPERATION__MORE_THAN:
+                set_domain_range(result, c + 1, INT64_MAX);
+                break;
+            case OPERATION__MORE_THAN_OR_EQUAL:
+                set_domain_range(result, c, INT64_MAX);
+                break;
+            case OPERATION__EQUAL_TO:
+                set_domain_range(result, c, c);
+                break;
+            case OPERATION__NOT_EQUAL_TO:
+                set_domain_range(result, c, c);
+                complement_domain(result);
+                break;
+            default:
+                break;
+            }
+            break;
+        }
+
+        case MASK_OP__TRUTH:
+        {
+            clear_domain(result);
+            if (value != 0)
+                complement_domain(result);
+            break;
+        }
+
+        case MASK_OP__SELECT:
+        {
+            // The boolean mask holds the values where the lhs is 1, and its complement holds the values where it is 0
+            bool equal = instruction->op == OPERATION__EQUAL_TO;
+            if (value == 0 || value == 1)
+            {
+                copy_domain(result, masks[instruction->lhs]);
+                if ((value == 1) != equal)
+                    complement_domain(result);
+            }
+            else
+            {
+                clear_domain(result);
+                if (!equal)
+                    complement_domain(result);
+            }
+            break;
+        }
+
+        case MASK_OP__AND:
+        {
+            copy_domain(result, masks[instruction->lhs]);
+            intersect_domains(result, masks[instruction->rhs]);
+            break;
+        }
+
+        case MASK_OP__OR:
+        {
+            copy_domain(result, masks[instruction->lhs]);
+            union_domains(result, masks[instruction->rhs]);
+            break;
+        }
+        }
+    }
+}
+
+// Printing & strings
+void print_bytecode(Bytecode *bytecode)
+{
+    size_t first_constant = bytecode->variables_count + bytecode->instances_count;
+    printf("\t%zu registers (%zu variables, %zu instances, %zu constants)\n", bytecode->registers_count, bytecode->variables_count, bytecode->instances_count, bytecode->constants_count);
+
+    for (size_t c = 0; c < bytecode->constants_count; c++)
+        printf("\tr%zu = %d\n", first_constant + c, bytecode->constants[c]);
+
+    for (size_t i = 0; i < bytecode->instructions_count; i++)
+    {
+        Instruction *instruction = bytecode->instructions + i;
+        printf("\tr%d = r%d %s r%d\n", instruction->result, instruction->lhs, operation_string(instruction->op), instruction->rhs);
+    }
+
+    printf("\tresult: r%zu\n", bytecode->result_register);
+}
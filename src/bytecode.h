@@ -0,0 +1,110 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "domain.h"
+#include "expression.h"
+
+// Bytecode
+// An arc expression compiled (for one rotation) into a flat list of instructions. Every operand of an
+// instruction is a register, and registers are laid out as:
+//
+//     [ variables | instances | constants | temporaries ]
+//
+// The first `variables_count` registers are the values of the arc's variables (in the arc's order,
+// so the rotation is already accounted for), followed by the indexes of the arc's instances and the
+// program's constants. This means the values being tested can be written straight into the registers,
+// and no instruction ever has to load anything.
+
+// Instruction
+typedef struct
+{
+    Operation op;
+    uint16_t result;
+    uint16_t lhs;
+    uint16_t rhs;
+} Instruction;
+
+// Bytecode
+typedef struct
+{
+    Instruction *instructions;
+    size_t instructions_count;
+
+    int *constants;
+    size_t constants_count;
+    size_t constants_capacity;
+
+    size_t variables_count;
+    size_t instances_count;
+    size_t registers_count;
+    size_t result_register;
+} Bytecode;
+
+// The most registers a compiled expression may use
+#define MAX_REGISTERS 256
+
+// MaskBytecode
+// Some expressions can also be compiled to find every supported value of the arc's primary variable at
+// once (for one set of values of the other variables). The parts of the expression that do not read the
+// primary variable are compiled to ordinary instructions, and the parts that do are compiled to mask
+// instructions, which build bitfields over the primary variable's domain. e.g. `primary + 1 < x` becomes
+// every value below `x - 1`, and `x = (primary > 3)` becomes every value above 3 if `x` is 1.
+// This is only done where the masks are exact, which is when the primary variable only appears as
+// `primary`, `primary + k` or `primary - k` on one side of a comparison (and otherwise the expression
+// is evaluated one value at a time).
+
+// MaskOp
+typedef enum
+{
+    MASK_OP__COMPARE, // masks[result] = the values v where `v + offset <op> registers[operand]`
+    MASK_OP__TRUTH,   // masks[result] = every value if registers[operand] is true, otherwise no values
+    MASK_OP__SELECT,  // masks[result] = the values v where `registers[operand] <op> (v in masks[lhs])` (op is = or !=)
+    MASK_OP__AND,     // masks[result] = masks[lhs] & masks[rhs]
+    MASK_OP__OR,      // masks[result] = masks[lhs] | masks[rhs]
+} MaskOp;
+
+// MaskInstruction
+typedef struct
+{
+    MaskOp mask_op;
+    Operation op;
+    uint16_t result;
+    uint16_t lhs;
+    uint16_t rhs;
+    uint16_t operand;
+    int offset;
+} MaskInstruction;
+
+// MaskBytecode
+typedef struct
+{
+    Bytecode *bytecode; // The instructions for the parts of the expression that do not read the primary variable
+
+    MaskInstruction *instructions;
+    size_t instructions_count;
+    size_t masks_count;
+    size_t result_mask;
+} MaskBytecode;
+
+// The most masks a compiled expression may use
+#define MAX_MASKS 16
+
+// Compiling
+Bytecode *compile_expression(Expression *expr, size_t rotation, size_t variables_count, size_t instances_count);
+MaskBytecode *compile_mask_expression(Expression *expr, size_t rotation, size_t variables_count, size_t instances_count); // Returns NULL if the masks would not be exact
+
+// Querying
+bool bytecode_reads_instances(Bytecode *bytecode);
+
+// Running
+void prepare_registers(Bytecode *bytecode, int *registers, size_t *instance_indexes);
+int run_bytecode(Bytecode *bytecode, int *registers); // Returns 0 (false) if the expression divides by 0
+void run_mask_bytecode(MaskBytecode *mask_bytecode, int *registers, Domain *masks);
+
+// Printing & strings
+void print_bytecode(Bytecode *bytecode);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,497 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+// NOTE: wingdi.h declares functions (e.g. `Arc`) with the same names as our types
+#define WIN32_LEAN_AND_MEAN
+#define NOGDI
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "cache.h"
+#include "memory.h"
+
+// Hashing (FNV-1a)
+#define HASH_OFFSET_BASIS 14695981039346656037ULL
+#define HASH_PRIME 1099511628211ULL
+
+uint64_t hash_bytes(uint64_t hash, const void *bytes, size_t size)
+{
+    const uint8_t *byte = (const uint8_t *)bytes;
+    for (size_t b = 0; b < size; b++)
+        hash = (hash ^ byte[b]) * HASH_PRIME;
+    return hash;
+}
+
+// Keys
+uint64_t cache_key(const char *source_text, const char **instance_count_args, size_t instance_count_args_count)
+{
+    uint64_t hash = hash_bytes(HASH_OFFSET_BASIS, source_text, strlen(source_text));
+    for (size_t i = 0; i < instance_count_args_count; i++)
+        hash = hash_bytes(hash, instance_count_args[i], strlen(instance_count_args[i]) + 1); // Including the terminator, to keep the arguments apart
+    return hash;
+}
+
+// The size of every struct stored in the cache, so that a cache written by a build where any of them differ is not used
+uint64_t cache_layout()
+{
+    size_t sizes[] = {
+        sizeof(void *), sizeof(size_t), sizeof(int),
+        sizeof(QuantumMap), sizeof(QuantumInstance), sizeof(QuantumVariable), sizeof(Node), sizeof(Property),
+        sizeof(Constraints), sizeof(PackedArc), sizeof(ArcFamily), sizeof(Channel), sizeof(ChannelWatch), sizeof(AllDifferent),
+        sizeof(Expression), sizeof(Bytecode), sizeof(Instruction), sizeof(MaskBytecode), sizeof(MaskInstruction), sizeof(SupportTable),
+    };
+    return hash_bytes(HASH_OFFSET_BASIS, sizes, sizeof(sizes));
+}
+
+// CacheWriter
+// Builds up the bytes of a cache file. While it is being built, each pointer in the file still points to the original
+// it was copied from, until it is pointed at the offset its copy was written to.
+typedef struct
+{
+    const void *original;
+    size_t offset;
+} WrittenObject;
+
+typedef struct
+{
+    uint8_t *bytes;
+    size_t bytes_count;
+    size_t bytes_capacity;
+
+    uint64_t *relocations; // The offset of every pointer that is not NULL
+    size_t relocations_count;
+    size_t relocations_capacity;
+
+    // Objects that may be shared (e.g. every rotation of a rule has the same expression) are only written once
+    WrittenObject *written;
+    size_t written_count;
+    size_t written_capacity;
+} CacheWriter;
+
+// Arrays are aligned for blocks of domain words (see `DOMAIN_WORDS_ALIGNMENT`)
+#define CACHE_ARRAY_ALIGNMENT 64
+#define CACHE_STRUCT_ALIGNMENT 16
+
+#define CACHED(writer, type, offset) ((type *)((writer)->bytes + (offset)))
+
+size_t write_bytes(CacheWriter *writer, const void *data, size_t size, size_t alignment)
+{
+    size_t offset = ((writer->bytes_count + alignment - 1) / alignment) * alignment;
+    RESERVE_ARRAY(writer->bytes, uint8_t, offset + size - writer->bytes_count);
+    memset(writer->bytes + writer->bytes_count, 0, offset - writer->bytes_count);
+    if (size > 0)
+        memcpy(writer->bytes + offset, data, size);
+
+    writer->bytes_count = offset + size;
+    return offset;
+}
+
+// Point the pointer at `field_offset` to `target_offset` (where an offset of 0 is NULL, as the header is there)
+void set_pointer(CacheWriter *writer, size_t field_offset, size_t target_offset)
+{
+    *CACHED(writer, uintptr_t, field_offset) = (uintptr_t)target_offset;
+    if (target_offset != 0)
+        *EXTEND_ARRAY(writer->relocations, uint64_t) = field_offset;
+}
+
+// Write the array that the pointer at `field_offset` points to, and point it at the copy
+size_t write_pointed_array(CacheWriter *writer, size_t field_offset, size_t element_size, size_t count, size_t alignment)
+{
+    const void *original = (const void *)*CACHED(writer, uintptr_t, field_offset);
+    size_t offset = original == NULL ? 0 : write_bytes(writer, original, element_size * count, alignment);
+    set_pointer(writer, field_offset, offset);
+    return offset;
+}
+
+void write_sub_string(CacheWriter *writer, size_t field_offset)
+{
+    size_t length = CACHED(writer, sub_string, field_offset)->len;
+    write_pointed_array(writer, field_offset + offsetof(sub_string, str), 1, length, 1);
+}
+
+size_t find_written(CacheWriter *writer, const void *original)
+{
+    for (size_t w = 0; w < writer->written_count; w++)
+        if (writer->written[w].original == original)
+            return writer->written[w].offset;
+    return 0;
+}
+
+void add_written(CacheWriter *writer, const void *original, size_t offset)
+{
+    *EXTEND_ARRAY(writer->written, WrittenObject) = (WrittenObject){.original = original, .offset = offset};
+}
+
+// Writing nodes
+size_t node_offset(QuantumMap *quantum_map, size_t nodes_offset, const Node *node)
+{
+    return node == NULL ? 0 : nodes_offset + sizeof(Node) * (size_t)(node - quantum_map->nodes);
+}
+
+size_t write_nodes(CacheWriter *writer, QuantumMap *quantum_map, size_t field_offset)
+{
+    size_t nodes_offset = write_pointed_array(writer, field_offset, sizeof(Node), quantum_map->nodes_count, CACHE_ARRAY_ALIGNMENT);
+
+    for (size_t n = 0; n < quantum_map->nodes_count; n++)
+    {
+        Node *node = quantum_map->nodes + n;
+        size_t offset = nodes_offset + sizeof(Node) * n;
+        CACHED(writer, Node, offset)->properties_capacity = node->properties_count;
+        write_sub_string(writer, offset + offsetof(Node, name));
+
+        size_t properties_offset = write_pointed_array(writer, offset + offsetof(Node, properties), sizeof(Property), node->properties_count, CACHE_ARRAY_ALIGNMENT);
+        for (size_t p = 0; p < node->properties_count; p++)
+        {
+            size_t property_offset = properties_offset + sizeof(Property) * p;
+            write_sub_string(writer, property_offset + offsetof(Property, name));
+            write_sub_string(writer, property_offset + offsetof(Property, type_name));
+            set_pointer(writer, property_offset + offsetof(Property, type) + offsetof(ExprType, node), node_offset(quantum_map, nodes_offset, node->properties[p].type.node));
+        }
+    }
+
+    return nodes_offset;
+}
+
+// Writing the quantum map
+size_t write_quantum_map(CacheWriter *writer, QuantumMap *quantum_map)
+{
+    size_t offset = write_bytes(writer, quantum_map, sizeof(QuantumMap), CACHE_STRUCT_ALIGNMENT);
+
+    size_t nodes_offset = write_nodes(writer, quantum_map, offset + offsetof(QuantumMap, nodes));
+
+    size_t instances_offset = write_pointed_array(writer, offset + offsetof(QuantumMap, instances), sizeof(QuantumInstance), quantum_map->instances_count, CACHE_ARRAY_ALIGNMENT);
+    for (size_t i = 0; i < quantum_map->instances_count; i++)
+        set_pointer(writer, instances_offset + sizeof(QuantumInstance) * i + offsetof(QuantumInstance, node), node_offset(quantum_map, nodes_offset, quantum_map->instances[i].node));
+
+    write_pointed_array(writer, offset + offsetof(QuantumMap, variables), sizeof(QuantumVariable), quantum_map->variables_count, CACHE_ARRAY_ALIGNMENT);
+    write_pointed_array(writer, offset + offsetof(QuantumMap, domain_words), sizeof(uint64_t), quantum_map->domain_words_count, CACHE_ARRAY_ALIGNMENT);
+    write_pointed_array(writer, offset + offsetof(QuantumMap, node_first_instance), sizeof(size_t), quantum_map->nodes_count, CACHE_ARRAY_ALIGNMENT);
+    write_pointed_array(writer, offset + offsetof(QuantumMap, node_instances_count), sizeof(size_t), quantum_map->nodes_count, CACHE_ARRAY_ALIGNMENT);
+
+    return offset;
+}
+
+// Writing arcs
+size_t write_expression(CacheWriter *writer, const Expression *expr)
+{
+    if (expr == NULL)
+        return 0;
+
+    size_t offset = find_written(writer, expr);
+    if (offset != 0)
+        return offset;
+
+    offset = write_bytes(writer, expr, sizeof(Expression), CACHE_STRUCT_ALIGNMENT);
+    add_written(writer, expr, offset);
+
+    switch (expr->variant)
+    {
+    case EXPR_VARIANT__UNRESOLVED_NAME:
+        write_sub_string(writer, offset + offsetof(Expression, name));
+        break;
+    case EXPR_VARIANT__BIN_OP:
+        set_pointer(writer, offset + offsetof(Expression, lhs), write_expression(writer, expr->lhs));
+        set_pointer(writer, offset + offsetof(Expression, rhs), write_expression(writer, expr->rhs));
+        break;
+    case EXPR_VARIANT__PROPERTY_ACCESS:
+        write_sub_string(writer, offset + offsetof(Expression, property_name));
+        break;
+    default:
+        break;
+    }
+
+    return offset;
+}
+
+size_t write_bytecode(CacheWriter *writer, const Bytecode *bytecode)
+{
+    if (bytecode == NULL)
+        return 0;
+
+    size_t offset = find_written(writer, bytecode);
+    if (offset != 0)
+        return offset;
+
+    offset = write_bytes(writer, bytecode, sizeof(Bytecode), CACHE_STRUCT_ALIGNMENT);
+    add_written(writer, bytecode, offset);
+
+    CACHED(writer, Bytecode, offset)->constants_capacity = bytecode->constants_count;
+    write_pointed_array(writer, offset + offsetof(Bytecode, instructions), sizeof(Instruction), bytecode->instructions_count, CACHE_ARRAY_ALIGNMENT);
+    write_pointed_array(writer, offset + offsetof(Bytecode, constants), sizeof(int), bytecode->constants_count, CACHE_ARRAY_ALIGNMENT);
+    return offset;
+}
+
+size_t write_mask_bytecode(CacheWriter *writer, const MaskBytecode *mask_bytecode)
+{
+    if (mask_bytecode == NULL)
+        return 0;
+
+    size_t offset = find_written(writer, mask_bytecode);
+    if (offset != 0)
+        return offset;
+
+    offset = write_bytes(writer, mask_bytecode, sizeof(MaskBytecode), CACHE_STRUCT_ALIGNMENT);
+    add_written(writer, mask_bytecode, offset);
+
+    set_pointer(writer, offset + offsetof(MaskBytecode, bytecode), write_bytecode(writer, mask_bytecode->bytecode));
+    write_pointed_array(writer, offset + offsetof(MaskBytecode, instructions), sizeof(MaskInstruction), mask_bytecode->instructions_count, CACHE_ARRAY_ALIGNMENT);
+    return offset;
+}
+
+size_t write_support_table(CacheWriter *writer, const SupportTable *support_table)
+{
+    if (support_table == NULL)
+        return 0;
+
+    size_t offset = find_written(writer, support_table);
+    if (offset != 0)
+        return offset;
+
+    offset = write_bytes(writer, support_table, sizeof(SupportTable), CACHE_STRUCT_ALIGNMENT);
+    add_written(writer, support_table, offset);
+
+    write_pointed_array(writer, offset + offsetof(SupportTable, rows), sizeof(uint64_t), support_table->rows_count * support_table->row_words_count, CACHE_ARRAY_ALIGNMENT);
+    write_pointed_array(writer, offset + offsetof(SupportTable, bases), sizeof(int), support_table->variables_count, CACHE_ARRAY_ALIGNMENT);
+    write_pointed_array(writer, offset + offsetof(SupportTable, strides), sizeof(size_t), support_table->variables_count, CACHE_ARRAY_ALIGNMENT);
+    return offset;
+}
+
+// Writing constraints
+// Arrays sliced by a variable's offsets are written along with their offsets
+void write_sliced_array(CacheWriter *writer, size_t offsets_field_offset, size_t array_field_offset, size_t *offsets, size_t variables_count)
+{
+    write_pointed_array(writer, offsets_field_offset, sizeof(size_t), variables_count + 1, CACHE_ARRAY_ALIGNMENT);
+    write_pointed_array(writer, array_field_offset, sizeof(size_t), offsets == NULL ? 0 : offsets[variables_count], CACHE_ARRAY_ALIGNMENT);
+}
+
+size_t write_constraints(CacheWriter *writer, Constraints *constraints)
+{
+    size_t offset = write_bytes(writer, constraints, sizeof(Constraints), CACHE_STRUCT_ALIGNMENT);
+
+    // Nothing is ever added to the constraints once they have been created
+    Constraints *cached = CACHED(writer, Constraints, offset);
+    cached->single_arcs_capacity = constraints->single_arcs_count;
+    cached->multi_arcs_capacity = constraints->multi_arcs_count;
+    cached->arc_families_capacity = constraints->arc_families_count;
+    cached->arc_indexes_capacity = constraints->arc_indexes_count;
+    cached->channels_capacity = constraints->channels_count;
+    cached->channel_watches_capacity = constraints->channel_watches_count;
+    cached->all_differents_capacity = constraints->all_differents_count;
+    set_pointer(writer, offset + offsetof(Constraints, arena), 0);
+
+    write_pointed_array(writer, offset + offsetof(Constraints, single_arcs), sizeof(PackedArc), constraints->single_arcs_count, CACHE_ARRAY_ALIGNMENT);
+    write_pointed_array(writer, offset + offsetof(Constraints, multi_arcs), sizeof(PackedArc), constraints->multi_arcs_count, CACHE_ARRAY_ALIGNMENT);
+    write_pointed_array(writer, offset + offsetof(Constraints, arc_indexes), sizeof(size_t), constraints->arc_indexes_count, CACHE_ARRAY_ALIGNMENT);
+
+    size_t families_offset = write_pointed_array(writer, offset + offsetof(Constraints, arc_families), sizeof(ArcFamily), constraints->arc_families_count, CACHE_ARRAY_ALIGNMENT);
+    for (size_t f = 0; f < constraints->arc_families_count; f++)
+    {
+        ArcFamily *family = constraints->arc_families + f;
+        size_t family_offset = families_offset + sizeof(ArcFamily) * f;
+        set_pointer(writer, family_offset + offsetof(ArcFamily, expr), write_expression(writer, family->expr));
+        set_pointer(writer, family_offset + offsetof(ArcFamily, bytecode), write_bytecode(writer, family->bytecode));
+        set_pointer(writer, family_offset + offsetof(ArcFamily, mask_bytecode), write_mask_bytecode(writer, family->mask_bytecode));
+        set_pointer(writer, family_offset + offsetof(ArcFamily, support_table), write_support_table(writer, family->support_table));
+    }
+
+    write_sliced_array(writer, offset + offsetof(Constraints, reading_arcs_offsets), offset + offsetof(Constraints, reading_arcs), constraints->reading_arcs_offsets, constraints->variables_count);
+
+    write_pointed_array(writer, offset + offsetof(Constraints, channels), sizeof(Channel), constraints->channels_count, CACHE_ARRAY_ALIGNMENT);
+    write_pointed_array(writer, offset + offsetof(Constraints, channel_watches), sizeof(ChannelWatch), constraints->channel_watches_count, CACHE_ARRAY_ALIGNMENT);
+    write_sliced_array(writer, offset + offsetof(Constraints, variable_watches_offsets), offset + offsetof(Constraints, variable_watches), constraints->variable_watches_offsets, constraints->variables_count);
+
+    size_t all_differents_offset = write_pointed_array(writer, offset + offsetof(Constraints, all_differents), sizeof(AllDifferent), constraints->all_differents_count, CACHE_ARRAY_ALIGNMENT);
+    for (size_t a = 0; a < constraints->all_differents_count; a++)
+    {
+        AllDifferent *all_different = constraints->all_differents + a;
+        size_t all_different_offset = all_differents_offset + sizeof(AllDifferent) * a;
+        CACHED(writer, AllDifferent, all_different_offset)->variable_indexes_capacity = all_different->variable_indexes_count;
+        write_pointed_array(writer, all_different_offset + offsetof(AllDifferent, variable_indexes), sizeof(size_t), all_different->variable_indexes_count, CACHE_ARRAY_ALIGNMENT);
+    }
+
+    write_sliced_array(writer, offset + offsetof(Constraints, variable_all_differents_offsets), offset + offsetof(Constraints, variable_all_differents), constraints->variable_all_differents_offsets, constraints->variables_count);
+
+    return offset;
+}
+
+// Write compiled cache
+bool write_compiled_cache(const char *path, uint64_t key, QuantumMap *quantum_map, Constraints *constraints)
+{
+    CacheWriter writer;
+    INIT_ARRAY(writer.bytes);
+    INIT_ARRAY(writer.relocations);
+    INIT_ARRAY(writer.written);
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(CacheHeader));
+    write_bytes(&writer, &header, sizeof(CacheHeader), CACHE_STRUCT_ALIGNMENT);
+
+    size_t quantum_map_offset = write_quantum_map(&writer, quantum_map);
+    size_t constraints_offset = write_constraints(&writer, constraints);
+
+    // NOTE: The relocations are counted before they are written, as writing them does not add any more
+    size_t relocations_count = writer.relocations_count;
+    size_t relocations_offset = write_bytes(&writer, writer.relocations, sizeof(uint64_t) * relocations_count, CACHE_STRUCT_ALIGNMENT);
+
+    CacheHeader *cached_header = CACHED(&writer, CacheHeader, 0);
+    memcpy(cached_header->magic, CACHE_MAGIC, sizeof(cached_header->magic));
+    cached_header->version = CACHE_VERSION;
+    cached_header->pointer_size = sizeof(void *);
+    cached_header->layout = cache_layout();
+    cached_header->key = key;
+    cached_header->size = writer.bytes_count;
+    cached_header->quantum_map_offset = quantum_map_offset;
+    cached_header->constraints_offset = constraints_offset;
+    cached_header->relocations_offset = relocations_offset;
+    cached_header->relocations_count = relocations_count;
+
+    // The file is written under another name and then renamed, so that a run reading the cache at the same time never
+    // sees part of a file
+    char *temp_path = (char *)malloc(strlen(path) + 5);
+    sprintf(temp_path, "%s.tmp", path);
+
+    bool written = false;
+    FILE *file = fopen(temp_path, "wb");
+    if (file != NULL)
+    {
+        written = fwrite(writer.bytes, 1, writer.bytes_count, file) == writer.bytes_count;
+        written = fclose(file) == 0 && written;
+    }
+
+#ifdef _WIN32
+    // NOTE: `rename` does not replace an existing file on Windows
+    if (written)
+        remove(path);
+#endif
+
+    written = written && rename(temp_path, path) == 0;
+    if (!written)
+        remove(temp_path);
+
+    free(temp_path);
+    free(writer.bytes);
+    free(writer.relocations);
+    free(writer.written);
+    return written;
+}
+
+// Mapping cache files
+bool map_cache_file(const char *path, CompiledCache *cache)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    // Pages are copied on write, so the file itself is never changed
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    if (mapping == NULL)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    void *view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    if (view == NULL)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    cache->view = (uint8_t *)view;
+    cache->size = (size_t)size.QuadPart;
+    cache->file_handle = file;
+    cache->mapping_handle = mapping;
+    return true;
+#else
+    int file = open(path, O_RDONLY);
+    if (file < 0)
+        return false;
+
+    struct stat file_stat;
+    if (fstat(file, &file_stat) != 0 || file_stat.st_size == 0)
+    {
+        close(file);
+        return false;
+    }
+
+    // Pages are copied on write, so the file itself is never changed
+    void *view = mmap(NULL, (size_t)file_stat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+    close(file); // The mapping stays valid once the file is closed
+    if (view == MAP_FAILED)
+        return false;
+
+    cache->view = (uint8_t *)view;
+    cache->size = (size_t)file_stat.st_size;
+    return true;
+#endif
+}
+
+void close_compiled_cache(CompiledCache *cache)
+{
+#ifdef _WIN32
+    UnmapViewOfFile(cache->view);
+    CloseHandle(cache->mapping_handle);
+    CloseHandle(cache->file_handle);
+#else
+    munmap(cache->view, cache->size);
+#endif
+}
+
+// Open compiled cache
+bool open_compiled_cache(const char *path, uint64_t key, CompiledCache *cache)
+{
+    if (!map_cache_file(path, cache))
+        return false;
+
+    CacheHeader *header = (CacheHeader *)cache->view;
+    bool valid = cache->size >= sizeof(CacheHeader) &&
+                 memcmp(header->magic, CACHE_MAGIC, sizeof(header->magic)) == 0 &&
+                 header->version == CACHE_VERSION &&
+                 header->pointer_size == sizeof(void *) &&
+                 header->layout == cache_layout() &&
+                 header->key == key &&
+                 header->size == cache->size &&
+                 header->quantum_map_offset + sizeof(QuantumMap) <= cache->size &&
+                 header->constraints_offset + sizeof(Constraints) <= cache->size &&
+                 header->relocations_offset + sizeof(uint64_t) * header->relocations_count <= cache->size;
+
+    if (!valid)
+    {
+        close_compiled_cache(cache);
+        return false;
+    }
+
+    // Point every pointer at where the file has been mapped
+    uint64_t *relocations = (uint64_t *)(cache->view + header->relocations_offset);
+    for (size_t r = 0; r < header->relocations_count; r++)
+    {
+        if (relocations[r] + sizeof(uintptr_t) > cache->size)
+        {
+            close_compiled_cache(cache);
+            return false;
+        }
+
+        uintptr_t *pointer = (uintptr_t *)(cache->view + relocations[r]);
+        *pointer += (uintptr_t)cache->view;
+    }
+
+    cache->quantum_map = (QuantumMap *)(cache->view + header->quantum_map_offset);
+    cache->constraints = (Constraints *)(cache->view + header->constraints_offset);
+    return true;
+}
@@ -0,0 +1,70 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "constraints.h"
+#include "quantum_map.h"
+
+// Compiled cache
+// Tokenising, parsing, resolving, creating the quantum map and (above all) creating the constraints always give the
+// same result for the same source text and instance counts. So, the quantum map and constraints can be written to a
+// file once, and every later run with the same source and instance counts can map the file into memory and go
+// straight to solving.
+//
+// The file is one block of bytes: a header, the quantum map and constraints structs, and then every array they point
+// to (including the program's nodes and the arcs' expressions, bytecode and support tables). Pointers are stored as
+// offsets from the start of the file, and the file ends with the offset of every pointer, so that loading only has
+// to add the address the file was mapped at to each of them. Everything else (e.g. the arcs and their indexes) is
+// used where it was mapped, without being copied or allocated. The file is mapped copy-on-write, so that the domains
+// can be narrowed in place without changing the file.
+//
+// A cache is only used if it was written by a build with the same version and struct layout, for the same key.
+#define CACHE_VERSION 1
+
+#define CACHE_MAGIC "SUNCACHE"
+
+// CacheHeader
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t pointer_size;
+    uint64_t layout; // Changes whenever the size of any struct stored in the cache does
+    uint64_t key;
+    uint64_t size; // The size of the whole file
+    uint64_t quantum_map_offset;
+    uint64_t constraints_offset;
+    uint64_t relocations_offset; // The offsets of every pointer in the file
+    uint64_t relocations_count;
+} CacheHeader;
+
+// CompiledCache
+typedef struct
+{
+    uint8_t *view; // Where the file is mapped
+    size_t size;
+#ifdef _WIN32
+    void *file_handle;
+    void *mapping_handle;
+#endif
+
+    QuantumMap *quantum_map;
+    Constraints *constraints;
+} CompiledCache;
+
+// Keys
+// The key of a source text, and the instance counts (e.g. `Person:32`) given alongside it
+uint64_t cache_key(const char *source_text, const char **instance_count_args, size_t instance_count_args_count);
+
+// Reading & writing caches
+// Returns false if there is no cache at `path`, or it cannot be used
+bool open_compiled_cache(const char *path, uint64_t key, CompiledCache *cache);
+void close_compiled_cache(CompiledCache *cache);
+
+// Returns false if the cache could not be written (the cache is only ever a shortcut, so this is not an error)
+bool write_compiled_cache(const char *path, uint64_t key, QuantumMap *quantum_map, Constraints *constraints);
+
+#endif
\ No newline at end of file
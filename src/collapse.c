@@ -1,34 +1,70 @@
 #include "collapse.h"
 #include "memory.h"
 
-CollapsedMap *collapse(QuantumMap *quantum_map)
+// Collapsed values
+int collapsed_value(QuantumMap *quantum_map, size_t instance, size_t property)
 {
-    CollapsedMap *collapsed_map = NEW(CollapsedMap);
-    size_t instances_count = quantum_map->instances_count;
+    size_t var_index = quantum_map->instances[instance].variables_array_index + property;
+    QuantumVariable *variable = quantum_map->variables + var_index;
+
+    // Most domains are a single word, whose value is the index of its one set bit
+    if (variable->kind == DOMAIN_KIND__BITFIELD && variable->words_count == 1)
+    {
+        uint64_t word = quantum_map->domain_words[variable->words_offset];
+        return word == 0 ? NO_VALUE : variable->base + __builtin_ctzll(word);
+    }
 
-    collapsed_map->instances = (CollapsedInstance *)malloc(sizeof(CollapsedInstance) * instances_count);
-    collapsed_map->instances_count = instances_count;
+    return first_domain_value(get_domain(quantum_map, var_index));
+}
+
+// Collapse
+CollapsedMap *collapse(QuantumMap *quantum_map)
+{
+    size_t types_count = quantum_map->nodes_count;
+    size_t columns_count = 0;
+    size_t values_count = 0;
+    for (size_t t = 0; t < types_count; t++)
+    {
+        columns_count += quantum_map->nodes[t].properties_count;
+        values_count += quantum_map->nodes[t].properties_count * quantum_map->node_instances_count[t];
+    }
 
-    for (size_t i = 0; i < instances_count; i++)
+    // The map is followed by its types, then their columns, then every value
+    // NOTE: Each part is at least as aligned as the next, so none of them need padding
+    size_t size = sizeof(CollapsedMap) + sizeof(CollapsedType) * types_count + sizeof(int *) * columns_count + sizeof(int) * values_count;
+    uint8_t *block = (uint8_t *)malloc(size);
+    if (block == NULL)
     {
-        QuantumInstance *quantum_instance = quantum_map->instances + i;
-        CollapsedInstance *collapsed_instance = collapsed_map->instances + i;
-        Node *node = quantum_instance->node;
+        fprintf(stderr, "Unable to allocate memory for the collapsed map\n");
+        exit(EXIT_FAILURE);
+    }
 
-        collapsed_instance->node = node;
-        collapsed_instance->variables = (uint_least8_t *)malloc(sizeof(uint_least8_t) * node->properties_count);
+    CollapsedMap *collapsed_map = (CollapsedMap *)block;
+    collapsed_map->types = (CollapsedType *)(block + sizeof(CollapsedMap));
+    collapsed_map->types_count = types_count;
+    collapsed_map->instances_count = quantum_map->instances_count;
 
-        for (size_t p = 0; p < node->properties_count; p++)
-        {
-            uint64_t var_bitfield = quantum_map->variables[quantum_instance->variables_array_index + p];
+    int **columns = (int **)(collapsed_map->types + types_count);
+    int *values = (int *)(columns + columns_count);
 
-            uint_least8_t value = 0;
-            while (!value_in_bitfield(value, var_bitfield))
-                value++;
+    for (size_t t = 0; t < types_count; t++)
+    {
+        CollapsedType *type = collapsed_map->types + t;
+        type->node = quantum_map->nodes + t;
+        type->first_instance = quantum_map->node_first_instance[t];
+        type->instances_count = quantum_map->node_instances_count[t];
+        type->columns = columns;
+        columns += type->node->properties_count;
+
+        for (size_t p = 0; p < type->node->properties_count; p++)
+        {
+            type->columns[p] = values;
+            values += type->instances_count;
 
-            collapsed_instance->variables[p] = value;
+            for (size_t i = 0; i < type->instances_count; i++)
+                type->columns[p][i] = collapsed_value(quantum_map, type->first_instance + i, p);
         }
     }
 
     return collapsed_map;
-}
\ No newline at end of file
+}
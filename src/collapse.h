@@ -6,4 +6,8 @@
 
 CollapsedMap *collapse(QuantumMap *quantum_map);
 
+// Every variable of a solved quantum map has one value left, so values can also be read from the quantum map
+// directly, without collapsing it first
+int collapsed_value(QuantumMap *quantum_map, size_t instance, size_t property);
+
 #endif
\ No newline at end of file
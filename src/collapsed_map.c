@@ -2,21 +2,31 @@
 
 #include "collapsed_map.h"
 
+// Free collapsed map
+void free_collapsed_map(CollapsedMap *collapsed_map)
+{
+    free(collapsed_map);
+}
+
+// Printing & strings
 void print_collapsed_map(CollapsedMap *collapsed_map)
 {
-    for (size_t i = 0; i < collapsed_map->instances_count; i++)
+    for (size_t t = 0; t < collapsed_map->types_count; t++)
     {
-        CollapsedInstance *instance = collapsed_map->instances + i;
-        Node *node = instance->node;
+        CollapsedType *type = collapsed_map->types + t;
+        Node *node = type->node;
 
-        printf("%03d ", i);
-        printf("%.*s\n", node->name.len, node->name.str);
-
-        for (size_t p = 0; p < node->properties_count; p++)
+        for (size_t i = 0; i < type->instances_count; i++)
         {
-            Property *property = node->properties + p;
-            uint_least8_t value = instance->variables[p];
-            printf("\t%.*s: %d\n", property->name.len, property->name.str, value);
+            printf("%03d ", type->first_instance + i);
+            printf("%.*s\n", node->name.len, node->name.str);
+
+            for (size_t p = 0; p < node->properties_count; p++)
+            {
+                Property *property = node->properties + p;
+                int value = type->columns[p][i];
+                printf("\t%.*s: %d\n", property->name.len, property->name.str, value);
+            }
         }
     }
-}
\ No newline at end of file
+}
@@ -5,20 +5,28 @@
 
 #include "program.h"
 
-// CollapsedInstance
+// CollapsedType
+// The instances of one node, which take consecutive IDs. The values of each property are stored together in a
+// column, indexed by `instance - first_instance`.
 typedef struct
 {
     Node *node;
-    uint_least8_t *variables;
-} CollapsedInstance;
+    size_t first_instance;
+    size_t instances_count;
+    int **columns; // One per property
+} CollapsedType;
 
 // CollapsedMap
+// NOTE: The map, its types, their columns and every value are a single allocation
 typedef struct
 {
-    CollapsedInstance *instances;
+    CollapsedType *types; // One per node, in the order their instances are numbered
+    size_t types_count;
     size_t instances_count;
 } CollapsedMap;
 
+void free_collapsed_map(CollapsedMap *collapsed_map);
+
 // Printing & strings
 void print_collapsed_map(CollapsedMap *collapsed_map);
 
@@ -0,0 +1,186 @@
+#include "conflict.h"
+
+// LevelSet
+void init_level_set(LevelSet *set)
+{
+    set->levels = NULL;
+    set->levels_count = 0;
+    set->levels_capacity = 0;
+}
+
+void clear_level_set(LevelSet *set)
+{
+    set->levels_count = 0;
+}
+
+bool level_set_contains(LevelSet *set, size_t level)
+{
+    for (size_t i = 0; i < set->levels_count; i++)
+        if (set->levels[i] == level)
+            return true;
+
+    return false;
+}
+
+void add_level(LevelSet *set, size_t level)
+{
+    if (level_set_contains(set, level))
+        return;
+
+    if (set->levels_count == set->levels_capacity)
+    {
+        set->levels_capacity = set->levels_capacity == 0 ? 8 : set->levels_capacity * 2;
+        set->levels = (size_t *)realloc(set->levels, sizeof(size_t) * set->levels_capacity);
+    }
+
+    set->levels[set->levels_count++] = level;
+}
+
+void remove_level(LevelSet *set, size_t level)
+{
+    for (size_t i = 0; i < set->levels_count; i++)
+    {
+        if (set->levels[i] == level)
+        {
+            set->levels[i] = set->levels[--set->levels_count];
+            return;
+        }
+    }
+}
+
+void merge_level_sets(LevelSet *set, LevelSet *other)
+{
+    for (size_t i = 0; i < other->levels_count; i++)
+        add_level(set, other->levels[i]);
+}
+
+// Returns 0 if the set is empty (i.e. the root, where no decisions have been made)
+size_t max_level(LevelSet *set)
+{
+    size_t max = 0;
+    for (size_t i = 0; i < set->levels_count; i++)
+        if (set->levels[i] > max)
+            max = set->levels[i];
+
+    return max;
+}
+
+// Explaining conflicts
+
+// Variables are marked with the propagator's current mark stamp, so that marks never need to be cleared
+void mark_variable(Propagator *propagator, size_t var_index)
+{
+    propagator->variable_marks[var_index] = propagator->mark_stamp;
+}
+
+bool variable_is_marked(Propagator *propagator, size_t var_index)
+{
+    return propagator->variable_marks[var_index] == propagator->mark_stamp;
+}
+
+// Mark each variable that a reason read when it narrowed a variable. Returns false if the reason
+// can no longer be looked up (i.e. it was a nogood that has since been forgotten).
+bool mark_reason_variables(Propagator *propagator, Reason reason)
+{
+    switch (reason.kind)
+    {
+    case REASON_KIND__INITIAL:
+    case REASON_KIND__DECISION:
+        return true;
+
+    case REASON_KIND__ARC:
+    {
+        PackedArc arc = propagator->constraints->multi_arcs[reason.index];
+        size_t *variables = packed_arc_variables(propagator->constraints, arc);
+        for (size_t n = 0; n < packed_arc_variables_count(propagator->constraints, arc); n++)
+            mark_variable(propagator, variables[n]);
+        return true;
+    }
+
+    case REASON_KIND__SINGLE_ARC:
+    {
+        PackedArc arc = propagator->constraints->single_arcs[reason.index];
+        mark_variable(propagator, packed_arc_variables(propagator->constraints, arc)[0]);
+        return true;
+    }
+
+    case REASON_KIND__ALL_DIFFERENT:
+    {
+        AllDifferent *all_different = propagator->constraints->all_differents + reason.index;
+        for (size_t n = 0; n < all_different->variable_indexes_count; n++)
+            mark_variable(propagator, all_different->variable_indexes[n]);
+        return true;
+    }
+
+    case REASON_KIND__CHANNEL:
+    {
+        mark_variable(propagator, reason.index);
+        mark_variable(propagator, reason.id);
+        return true;
+    }
+
+    case REASON_KIND__NOGOOD:
+    {
+        NogoodStore *nogoods = propagator->nogoods;
+        if (!nogood_is_current(nogoods, reason.index, reason.id))
+            return false;
+
+        Nogood *nogood = nogoods->nogoods + reason.index;
+        for (size_t i = 0; i < nogood->literals_count; i++)
+            mark_variable(propagator, nogood->literals[i].var_index);
+        return true;
+    }
+    }
+
+    return false;
+}
+
+// Walk backwards through the trail's events, collecting the level of every decision that
+// (directly or indirectly) narrowed one of the marked variables
+void explain_marked_variables(Propagator *propagator, LevelSet *explanation)
+{
+    Trail *trail = propagator->trail;
+
+    for (size_t e = trail->events_count; e > 0; e--)
+    {
+        TrailEvent *event = trail->events + (e - 1);
+        if (!variable_is_marked(propagator, event->var_index))
+            continue;
+
+        if (event->reason.kind == REASON_KIND__DECISION)
+        {
+            add_level(explanation, event->level);
+            continue;
+        }
+
+        // If the reason has been forgotten, assume that every decision up to that point was involved
+        if (!mark_reason_variables(propagator, event->reason))
+        {
+            for (size_t level = 1; level <= event->level; level++)
+                add_level(explanation, level);
+        }
+    }
+}
+
+// Explain the conflict found by the last failed call to `propagate`
+void explain_conflict(Propagator *propagator, LevelSet *explanation)
+{
+    propagator->mark_stamp++;
+    mark_variable(propagator, propagator->conflict_var_index);
+    if (!mark_reason_variables(propagator, propagator->conflict_reason))
+    {
+        for (size_t level = 1; level <= propagator->trail->levels_count; level++)
+            add_level(explanation, level);
+        return;
+    }
+
+    explain_marked_variables(propagator, explanation);
+}
+
+// Explain why a variable's domain has been narrowed to what it currently is
+void explain_variable(Propagator *propagator, size_t var_index, LevelSet *explanation)
+{
+    propagator->mark_stamp++;
+    mark_variable(propagator, var_index);
+    explain_marked_variables(propagator, explanation);
+}
@@ -0,0 +1,36 @@
+#ifndef CONFLICT_H
+#define CONFLICT_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "propagate.h"
+
+// Conflict analysis
+// Explains why a variable was left with no possible values (or why a variable's domain is what it is)
+// in terms of the levels of the decisions that led to it. This is done by walking backwards through the
+// events on the trail, starting from the variables involved, and following the reason for each narrowing
+// back to the variables the reason read. The explanation may contain more decisions than are strictly
+// necessary, but never fewer.
+
+// LevelSet
+typedef struct
+{
+    size_t *levels;
+    size_t levels_count;
+    size_t levels_capacity;
+} LevelSet;
+
+void init_level_set(LevelSet *set);
+void clear_level_set(LevelSet *set);
+bool level_set_contains(LevelSet *set, size_t level);
+void add_level(LevelSet *set, size_t level);
+void remove_level(LevelSet *set, size_t level);
+void merge_level_sets(LevelSet *set, LevelSet *other);
+size_t max_level(LevelSet *set);
+
+// Explaining conflicts
+void explain_conflict(Propagator *propagator, LevelSet *explanation);
+void explain_variable(Propagator *propagator, size_t var_index, LevelSet *explanation);
+
+#endif
\ No newline at end of file
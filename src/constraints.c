@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "arena.h"
 #include "constraints.h"
 #include "memory.h"
 
@@ -19,6 +20,7 @@ typedef struct
 {
     VariableReference *variable_references;
     size_t variable_references_count;
+    size_t variable_references_capacity;
 } ConversionResult; // CLEANUP: Is there a better name for this?
 
 size_t get_reference_index_or_create_one(ConversionResult *result, size_t placeholder_index, size_t property_offset)
@@ -39,9 +41,9 @@ size_t get_reference_index_or_create_one(ConversionResult *result, size_t placeh
 }
 
 // Convert a rule's expression into an arc expression
-Expression *convert_expression(ConversionResult *result, Rule *rule, Expression *program_expression)
+Expression *convert_expression(Arena *arena, ConversionResult *result, Rule *rule, Expression *program_expression)
 {
-    Expression *expr = NEW(Expression);
+    Expression *expr = ARENA_NEW(arena, Expression);
 
     switch (program_expression->variant)
     {
@@ -62,8 +64,8 @@ Expression *convert_expression(ConversionResult *result, Rule *rule, Expression
     {
         expr->variant = EXPR_VARIANT__BIN_OP;
         expr->op = program_expression->op;
-        expr->lhs = convert_expression(result, rule, program_expression->lhs);
-        expr->rhs = convert_expression(result, rule, program_expression->rhs);
+        expr->lhs = convert_expression(arena, result, rule, program_expression->lhs);
+        expr->rhs = convert_expression(arena, result, rule, program_expression->rhs);
         break;
     }
 
@@ -85,178 +87,699 @@ Expression *convert_expression(ConversionResult *result, Rule *rule, Expression
     return expr;
 }
 
-// Create constraints
-void create_arcs_from_rule(Constraints *constraints, Rule *rule, QuantumMap *quantum_map)
+// Whether every instance an arc expression refers to is the instance of one placeholder
+bool only_refers_to_placeholder(Expression *expr, size_t placeholder_index)
 {
-    ConversionResult result;
-    INIT_ARRAY(result.variable_references);
+    if (expr->variant == EXPR_VARIANT__INSTANCE_REFERENCE_INDEX)
+        return expr->instance_reference_index == placeholder_index;
 
-    // FIXME: The expression that is returned by `convert_expression` never has an "owning"
-    //        reference created for it, meaning it's not clear how it would be freed? Once
-    //        it is clearer how this should be done, fix this!
-    Expression *arc_expression = convert_expression(&result, rule, rule->expression);
+    if (expr->variant == EXPR_VARIANT__BIN_OP)
+        return only_refers_to_placeholder(expr->lhs, placeholder_index) && only_refers_to_placeholder(expr->rhs, placeholder_index);
 
-    if (result.variable_references_count == 0)
+    return true;
+}
+
+// Point every instance reference in an arc expression at the same instance
+void set_instance_references(Expression *expr, size_t instance_reference_index)
+{
+    if (expr->variant == EXPR_VARIANT__INSTANCE_REFERENCE_INDEX)
+        expr->instance_reference_index = instance_reference_index;
+    else if (expr->variant == EXPR_VARIANT__BIN_OP)
     {
-        fprintf(stderr, "Internal error: Somehow created an arc that constraints no values");
-        exit(EXIT_FAILURE);
+        set_instance_references(expr->lhs, instance_reference_index);
+        set_instance_references(expr->rhs, instance_reference_index);
     }
+}
+
+// Create channels
+// Match a comparison between the value of one placeholder and a property of another (in either order)
+bool match_channel_comparison(Expression *expr, Operation op, size_t value_placeholder_index, size_t access_placeholder_index, size_t *property_offset)
+{
+    if (expr->variant != EXPR_VARIANT__BIN_OP || expr->op != op)
+        return false;
 
-    // Arcs that constrain a single variable (and thus have one placeholder)
-    if (result.variable_references_count == 1)
+    Expression *value = expr->lhs;
+    Expression *access = expr->rhs;
+    if (value->variant != EXPR_VARIANT__PLACEHOLDER_VALUE)
     {
-        Placeholder *placeholder = rule->placeholders;
+        value = expr->rhs;
+        access = expr->lhs;
+    }
 
-        for (size_t i = 0; i < quantum_map->instances_count; i++)
-        {
-            QuantumInstance *instance = quantum_map->instances + i;
-            if (instance->node != placeholder->type.node)
-                continue;
+    if (value->variant != EXPR_VARIANT__PLACEHOLDER_VALUE || value->placeholder_value_index != value_placeholder_index)
+        return false;
 
-            Arc *arc = EXTEND_ARRAY(constraints->single_arcs, Arc);
-            arc->expr = arc_expression;
-            arc->expr_rotation = 0;
+    if (access->variant != EXPR_VARIANT__PROPERTY_ACCESS || access->access_placeholder_index != access_placeholder_index)
+        return false;
 
-            arc->variable_indexes_count = 1;
-            arc->variable_indexes = (size_t *)malloc(sizeof(size_t));
-            arc->variable_indexes[0] = instance->variables_array_index + result.variable_references[0].property_offset;
+    *property_offset = access->access_property_offset;
+    return true;
+}
 
-            arc->instance_indexes_count = 1;
-            arc->instance_indexes = (size_t *)malloc(sizeof(size_t));
-            arc->instance_indexes[0] = i;
+// Returns false (and creates nothing) if the rule is not of the form `(~inverse != x.forward) OR (~inverse.inverse = x)`
+bool create_channel_from_rule(Constraints *constraints, Program *program, Rule *rule)
+{
+    if (rule->placeholders_count != 2 || rule->placeholders[0].intermediate || !rule->placeholders[1].intermediate)
+        return false;
+
+    Expression *expr = rule->expression;
+    if (expr->variant != EXPR_VARIANT__BIN_OP || expr->op != OPERATION__LOGICAL_OR)
+        return false;
+
+    size_t forward_offset, inverse_offset;
+    if (!match_channel_comparison(expr->lhs, OPERATION__NOT_EQUAL_TO, 1, 0, &forward_offset))
+        return false;
+    if (!match_channel_comparison(expr->rhs, OPERATION__EQUAL_TO, 0, 1, &inverse_offset))
+        return false;
+
+    Node *forward_node = rule->placeholders[0].type.node;
+    Node *inverse_node = rule->placeholders[1].type.node;
+    Property *forward = forward_node->properties + forward_offset;
+    Property *inverse = inverse_node->properties + inverse_offset;
+    if (forward->type.primitive != TYPE_PRIMITIVE__NODE || forward->type.node != inverse_node)
+        return false;
+    if (inverse->type.primitive != TYPE_PRIMITIVE__NODE || inverse->type.node != forward_node)
+        return false;
+
+    Channel *channel = EXTEND_ARRAY(constraints->channels, Channel);
+    channel->forward_node_index = forward_node - program->nodes;
+    channel->forward_property_offset = forward_offset;
+    channel->inverse_node_index = inverse_node - program->nodes;
+    channel->inverse_property_offset = inverse_offset;
+    return true;
+}
+
+// Watch the `forward` variable of every `x` and the `inverse` variable of every `y` of each channel
+void create_channel_watches(Constraints *constraints, QuantumMap *quantum_map)
+{
+    INIT_ARRAY(constraints->channel_watches);
+
+    for (size_t c = 0; c < constraints->channels_count; c++)
+    {
+        Channel *channel = constraints->channels + c;
+        for (int inverse = 0; inverse < 2; inverse++)
+        {
+            size_t n = inverse ? channel->inverse_node_index : channel->forward_node_index;
+            size_t first_instance = quantum_map->node_first_instance[n];
+            RESERVE_ARRAY(constraints->channel_watches, ChannelWatch, quantum_map->node_instances_count[n]);
+            for (size_t i = first_instance; i < first_instance + quantum_map->node_instances_count[n]; i++)
+            {
+                ChannelWatch *watch = EXTEND_ARRAY(constraints->channel_watches, ChannelWatch);
+                watch->channel_index = c;
+                watch->instance_index = i;
+                watch->inverse = inverse;
+            }
         }
+    }
 
-        return;
+    // Index the watches of each variable
+    size_t variables_count = quantum_map->variables_count;
+    size_t *offsets = (size_t *)calloc(variables_count + 1, sizeof(size_t));
+    for (size_t w = 0; w < constraints->channel_watches_count; w++)
+    {
+        ChannelWatch *watch = constraints->channel_watches + w;
+        Channel *channel = constraints->channels + watch->channel_index;
+        offsets[channel_variable(channel, quantum_map, watch->instance_index, watch->inverse) + 1]++;
     }
 
-    // Arcs that constrain a multiple variables (and thus may have multiple placeholders)
-    size_t total_placeholders = rule->placeholders_count;
-    size_t *instance_index = (size_t *)malloc(sizeof(size_t) * total_placeholders);
+    for (size_t v = 0; v < variables_count; v++)
+        offsets[v + 1] += offsets[v];
 
-    for (size_t i = 0; i < total_placeholders; i++)
-        instance_index[i] = 0;
+    size_t *watches = (size_t *)malloc(sizeof(size_t) * (offsets[variables_count] + 1));
+    size_t *next = (size_t *)malloc(sizeof(size_t) * (variables_count + 1));
+    for (size_t v = 0; v < variables_count; v++)
+        next[v] = offsets[v];
 
-    while (true)
+    for (size_t w = 0; w < constraints->channel_watches_count; w++)
     {
-        // Skip combinations of instances until we find a combination that patch the placeholders of the rule
+        ChannelWatch *watch = constraints->channel_watches + w;
+        Channel *channel = constraints->channels + watch->channel_index;
+        watches[next[channel_variable(channel, quantum_map, watch->instance_index, watch->inverse)]++] = w;
+    }
 
-        // TODO: For right now, we say that two non-intermediate placeholders of the same node type
-        //       cannot represent the same instance. This is a "for now" solution, but I'm not sure
-        //       what the semantics here really ought to be?
+    free(next);
 
-        // CLEANUP: This code _works_, but it probably isn't particularly efficient!
+    constraints->variable_watches_offsets = offsets;
+    constraints->variable_watches = watches;
+}
 
-        // CLEANUP: Right now, this will create essentially duplicate arcs in any situation where there are
-        //          multiple placeholders of the same node types. e.g. `Thing x Thing y: x.foo = y.foo` will result in:
-        //          - 000.foo = 001.foo (2 rotations)
-        //          - 001.foo = 000.foo (2 rotations)
-        //          Once the semantics for rule selectors are decided, look into how this can best be optimised!
+// Create all different constraints
+// Field
+// A property of every instance of a node (e.g. `x.next` for every `Chain x`)
+typedef struct
+{
+    size_t node_index;
+    size_t property_offset;
+} Field;
 
-        // Increment set of instance indexes
-        {
-            bool complete = false;
-            size_t n = 0;
-            while (n < total_placeholders)
-            {
-                QuantumInstance *instance = quantum_map->instances + instance_index[n];
-                Placeholder *placeholder = rule->placeholders + n;
+bool fields_match(Field a, Field b)
+{
+    return a.node_index == b.node_index && a.property_offset == b.property_offset;
+}
 
-                // If the instance at the current index is valid
-                if (instance->node == placeholder->type.node)
-                {
-                    // Prevent non-intermediate placeholders from being the same index as others
-                    bool no_repeats = true;
-                    if (!placeholder->intermediate)
-                    {
-                        for (size_t v = 0; v < n; v++)
-                        {
-                            if ((rule->placeholders + v)->intermediate)
-                                continue;
-
-                            if (instance_index[v] == instance_index[n])
-                            {
-                                no_repeats = false;
-                                n = v;
-                                break;
-                            }
-                        }
-                    }
+// Returns false if the rule is not of the form `FOR X x Y y: x.p != y.q`, or if the rule does not say that the
+// field `p` of every `X` is different to the field `q` of every `Y`
+bool match_inequality_rule(Program *program, QuantumMap *quantum_map, Rule *rule, Field *a, Field *b)
+{
+    if (rule->placeholders_count != 2 || rule->placeholders[0].intermediate || rule->placeholders[1].intermediate)
+        return false;
+
+    Expression *expr = rule->expression;
+    if (expr->variant != EXPR_VARIANT__BIN_OP || expr->op != OPERATION__NOT_EQUAL_TO)
+        return false;
+    if (expr->lhs->variant != EXPR_VARIANT__PROPERTY_ACCESS || expr->rhs->variant != EXPR_VARIANT__PROPERTY_ACCESS)
+        return false;
+    if (expr->lhs->access_placeholder_index == expr->rhs->access_placeholder_index)
+        return false;
+
+    a->node_index = rule->placeholders[expr->lhs->access_placeholder_index].type.node - program->nodes;
+    a->property_offset = expr->lhs->access_property_offset;
+    b->node_index = rule->placeholders[expr->rhs->access_placeholder_index].type.node - program->nodes;
+    b->property_offset = expr->rhs->access_property_offset;
+
+    // The two placeholders are never the same instance, so `x.p != y.q` on the same node says nothing about `x.p != x.q`
+    if (a->node_index == b->node_index && a->property_offset != b->property_offset)
+        return false;
+
+    // Bounds domains have too many values to match
+    Field fields[2] = {*a, *b};
+    for (size_t f = 0; f < 2; f++)
+    {
+        size_t n = fields[f].node_index;
+        if (quantum_map->node_instances_count[n] == 0)
+            return false;
 
-                    // Move onto next placeholder
-                    if (no_repeats)
-                    {
-                        n++;
-                        continue;
-                    }
-                }
+        QuantumInstance *instance = quantum_map->instances + quantum_map->node_first_instance[n];
+        if (quantum_map->variables[instance->variables_array_index + fields[f].property_offset].kind != DOMAIN_KIND__BITFIELD)
+            return false;
+    }
 
-                // Move onto next index
-                instance_index[n]++;
+    return true;
+}
 
-                while (instance_index[n] >= quantum_map->instances_count)
-                {
-                    n++;
+// Group fields whose inequality rules make every one of their variables different to every other, and create an
+// all different constraint for each group. Rules that are enforced by an all different constraint are marked as covered.
+void create_all_differents(Constraints *constraints, Program *program, QuantumMap *quantum_map, bool *rule_is_covered)
+{
+    INIT_ARRAY(constraints->all_differents);
+
+    // Find every inequality rule
+    size_t *rules;
+    size_t rules_count;
+    size_t rules_capacity;
+    INIT_ARRAY(rules);
+    Field *lhs_fields = (Field *)malloc(sizeof(Field) * (program->rules_count + 1));
+    Field *rhs_fields = (Field *)malloc(sizeof(Field) * (program->rules_count + 1));
+    for (size_t r = 0; r < program->rules_count; r++)
+    {
+        Field a, b;
+        if (!match_inequality_rule(program, quantum_map, program->rules + r, &a, &b))
+            continue;
+
+        lhs_fields[rules_count] = a;
+        rhs_fields[rules_count] = b;
+        *EXTEND_ARRAY(rules, size_t) = r;
+    }
+
+    // Grow a group from each field whose variables are all different to each other (i.e. `x.p != y.p` for the same node)
+    bool *grouped = (bool *)calloc(rules_count + 1, sizeof(bool));
+    for (size_t i = 0; i < rules_count; i++)
+    {
+        if (grouped[i] || !fields_match(lhs_fields[i], rhs_fields[i]))
+            continue;
 
-                    if (n >= total_placeholders)
+        Field *group;
+        size_t group_count;
+        size_t group_capacity;
+        INIT_ARRAY(group);
+        *EXTEND_ARRAY(group, Field) = lhs_fields[i];
+
+        // Add every other such field that is different to every field already in the group
+        for (size_t j = i + 1; j < rules_count; j++)
+        {
+            if (grouped[j] || !fields_match(lhs_fields[j], rhs_fields[j]))
+                continue;
+
+            bool in_group = false;
+            size_t connections = 0;
+            for (size_t g = 0; g < group_count; g++)
+            {
+                in_group = in_group || fields_match(group[g], lhs_fields[j]);
+                for (size_t k = 0; k < rules_count; k++)
+                {
+                    if ((fields_match(lhs_fields[k], group[g]) && fields_match(rhs_fields[k], lhs_fields[j])) ||
+                        (fields_match(rhs_fields[k], group[g]) && fields_match(lhs_fields[k], lhs_fields[j])))
                     {
-                        complete = true;
+                        connections++;
                         break;
                     }
-
-                    instance_index[n]++;
-                    for (size_t v = 1; v < n; v++)
-                        instance_index[v] = 0;
-                    n = 1;
                 }
             }
 
-            if (complete)
-                break;
+            if (!in_group && connections == group_count)
+                *EXTEND_ARRAY(group, Field) = lhs_fields[j];
         }
 
-        // Create an arc for each constrained variable
-        for (size_t rotation = 0; rotation < result.variable_references_count; rotation++)
+        // Every rule between fields of the group is covered by the all different constraint
+        for (size_t k = 0; k < rules_count; k++)
         {
-            Arc *arc = EXTEND_ARRAY(constraints->multi_arcs, Arc);
-            arc->expr = arc_expression;
-            arc->expr_rotation = rotation;
+            bool lhs_in_group = false;
+            bool rhs_in_group = false;
+            for (size_t g = 0; g < group_count; g++)
+            {
+                lhs_in_group = lhs_in_group || fields_match(group[g], lhs_fields[k]);
+                rhs_in_group = rhs_in_group || fields_match(group[g], rhs_fields[k]);
+            }
 
-            arc->instance_indexes_count = total_placeholders;
-            arc->instance_indexes = (size_t *)malloc(sizeof(size_t) * total_placeholders);
-            for (size_t n = 0; n < total_placeholders; n++)
+            if (lhs_in_group && rhs_in_group)
             {
-                arc->instance_indexes[n] = instance_index[n];
+                grouped[k] = true;
+                rule_is_covered[rules[k]] = true;
             }
+        }
 
-            arc->variable_indexes_count = result.variable_references_count;
-            arc->variable_indexes = (size_t *)malloc(sizeof(size_t) * arc->variable_indexes_count);
-            for (size_t v = 0; v < result.variable_references_count; v++)
+        // Create the constraint over every instance's variable of each field
+        AllDifferent *all_different = EXTEND_ARRAY(constraints->all_differents, AllDifferent);
+        INIT_ARRAY(all_different->variable_indexes);
+        int64_t min_value = INT64_MAX;
+        int64_t max_value = INT64_MIN;
+        for (size_t g = 0; g < group_count; g++)
+        {
+            size_t n = group[g].node_index;
+            size_t first_instance = quantum_map->node_first_instance[n];
+            RESERVE_ARRAY(all_different->variable_indexes, size_t, quantum_map->node_instances_count[n]);
+            for (size_t i = first_instance; i < first_instance + quantum_map->node_instances_count[n]; i++)
             {
-                size_t n = (v + rotation) % result.variable_references_count;
-                VariableReference info = result.variable_references[v];
-                QuantumInstance *instance = quantum_map->instances + instance_index[info.placeholder_index];
-                arc->variable_indexes[n] = instance->variables_array_index + info.property_offset;
+                size_t var_index = quantum_map->instances[i].variables_array_index + group[g].property_offset;
+                *EXTEND_ARRAY(all_different->variable_indexes, size_t) = var_index;
+
+                QuantumVariable *variable = quantum_map->variables + var_index;
+                if (variable->base < min_value)
+                    min_value = variable->base;
+                if ((int64_t)variable->base + (int64_t)variable->values_count - 1 > max_value)
+                    max_value = (int64_t)variable->base + (int64_t)variable->values_count - 1;
             }
         }
 
-        // Increment to a new combination of instances
+        all_different->min_value = (int)min_value;
+        all_different->values_count = (size_t)(max_value - min_value + 1);
+        free(group);
+    }
+
+    free(grouped);
+    free(lhs_fields);
+    free(rhs_fields);
+    free(rules);
+
+    // Index the all different constraints on each variable
+    size_t variables_count = quantum_map->variables_count;
+    size_t *offsets = (size_t *)calloc(variables_count + 1, sizeof(size_t));
+    for (size_t a = 0; a < constraints->all_differents_count; a++)
+    {
+        AllDifferent *all_different = constraints->all_differents + a;
+        for (size_t i = 0; i < all_different->variable_indexes_count; i++)
+            offsets[all_different->variable_indexes[i] + 1]++;
+    }
+
+    for (size_t v = 0; v < variables_count; v++)
+        offsets[v + 1] += offsets[v];
+
+    size_t *all_differents = (size_t *)malloc(sizeof(size_t) * (offsets[variables_count] + 1));
+    size_t *next = (size_t *)malloc(sizeof(size_t) * (variables_count + 1));
+    for (size_t v = 0; v < variables_count; v++)
+        next[v] = offsets[v];
+
+    for (size_t a = 0; a < constraints->all_differents_count; a++)
+    {
+        AllDifferent *all_different = constraints->all_differents + a;
+        for (size_t i = 0; i < all_different->variable_indexes_count; i++)
+            all_differents[next[all_different->variable_indexes[i]]++] = a;
+    }
+
+    free(next);
+
+    constraints->variable_all_differents_offsets = offsets;
+    constraints->variable_all_differents = all_differents;
+}
+
+// Symmetric placeholders
+// Swapping the instances of two placeholders of the same node type gives the same constraint if the rule's expression
+// reads the same after swapping the placeholders. e.g. `Thing x Thing y: x.foo = y.foo` says the same thing about
+// instances 000 and 001 whichever way around they are given, so only one of those combinations needs arcs.
+size_t swap_placeholder(size_t placeholder_index, size_t p, size_t q)
+{
+    if (placeholder_index == p)
+        return q;
+    if (placeholder_index == q)
+        return p;
+    return placeholder_index;
+}
+
+// Find the operation that gives the same result with its operands the other way around (e.g. `<` for `>`)
+// Returns false if there is no such operation
+bool operands_swapped_operation(Operation op, Operation *swapped)
+{
+    switch (op)
+    {
+    case OPERATION__MUL:
+    case OPERATION__ADD:
+    case OPERATION__EQUAL_TO:
+    case OPERATION__NOT_EQUAL_TO:
+    case OPERATION__LOGICAL_AND:
+    case OPERATION__LOGICAL_OR:
+        *swapped = op;
+        return true;
+    case OPERATION__LESS_THAN:
+        *swapped = OPERATION__MORE_THAN;
+        return true;
+    case OPERATION__MORE_THAN:
+        *swapped = OPERATION__LESS_THAN;
+        return true;
+    case OPERATION__LESS_THAN_OR_EQUAL:
+        *swapped = OPERATION__MORE_THAN_OR_EQUAL;
+        return true;
+    case OPERATION__MORE_THAN_OR_EQUAL:
+        *swapped = OPERATION__LESS_THAN_OR_EQUAL;
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Returns true if `a` is the same as `b` with placeholders `p` and `q` swapped
+// NOTE: This only looks for operands that have been written the other way around, so it can miss some expressions
+//       that are equivalent (which just means their arcs are not deduplicated)
+bool expressions_match_swapped(Expression *a, Expression *b, size_t p, size_t q)
+{
+    if (a->variant != b->variant)
+        return false;
+
+    switch (a->variant)
+    {
+    case EXPR_VARIANT__LITERAL:
+        if (a->literal_value.type_primitive != b->literal_value.type_primitive)
+            return false;
+        if (a->literal_value.type_primitive == TYPE_PRIMITIVE__BOOL)
+            return a->literal_value.boolean == b->literal_value.boolean;
+        return a->literal_value.number == b->literal_value.number;
+
+    case EXPR_VARIANT__PLACEHOLDER_VALUE:
+        return a->placeholder_value_index == swap_placeholder(b->placeholder_value_index, p, q);
+
+    case EXPR_VARIANT__PROPERTY_ACCESS:
+        return a->access_placeholder_index == swap_placeholder(b->access_placeholder_index, p, q) &&
+               a->access_property_offset == b->access_property_offset;
+
+    case EXPR_VARIANT__BIN_OP:
+    {
+        if (a->op == b->op && expressions_match_swapped(a->lhs, b->lhs, p, q) && expressions_match_swapped(a->rhs, b->rhs, p, q))
+            return true;
+
+        Operation swapped;
+        if (!operands_swapped_operation(a->op, &swapped) || swapped != b->op)
+            return false;
+
+        return expressions_match_swapped(a->lhs, b->rhs, p, q) && expressions_match_swapped(a->rhs, b->lhs, p, q);
+    }
+
+    default:
+        return false;
+    }
+}
+
+// Find which pairs of placeholders can be swapped without changing the rule, and are therefore only given their
+// instances in increasing order. `symmetric` has an entry for each pair `(m, n)`, at `m * placeholders_count + n`.
+bool *find_symmetric_placeholders(Rule *rule)
+{
+    size_t count = rule->placeholders_count;
+    bool *symmetric = (bool *)calloc(count * count, sizeof(bool));
+
+    for (size_t n = 1; n < count; n++)
+    {
+        for (size_t m = 0; m < n; m++)
+        {
+            Placeholder *a = rule->placeholders + m;
+            Placeholder *b = rule->placeholders + n;
+            if (a->intermediate || b->intermediate || a->type.node != b->type.node)
+                continue;
+
+            symmetric[m * count + n] = expressions_match_swapped(rule->expression, rule->expression, m, n);
+        }
+    }
+
+    return symmetric;
+}
+
+// Returns true if some pair of symmetric placeholders is not in increasing order
+bool swaps_symmetric_instances(Rule *rule, bool *symmetric, size_t *instance_index)
+{
+    size_t count = rule->placeholders_count;
+    for (size_t n = 1; n < count; n++)
+    {
+        for (size_t m = 0; m < n; m++)
+            if (symmetric[m * count + n] && instance_index[m] > instance_index[n])
+                return true;
+    }
+
+    return false;
+}
+
+// Create constraints
+// TODO: For right now, we say that two non-intermediate placeholders of the same node type
+//       cannot represent the same instance. This is a "for now" solution, but I'm not sure
+//       what the semantics here really ought to be?
+bool repeats_instance(Rule *rule, size_t *instance_index)
+{
+    for (size_t n = 1; n < rule->placeholders_count; n++)
+    {
+        if (rule->placeholders[n].intermediate)
+            continue;
+
+        for (size_t m = 0; m < n; m++)
+            if (!rule->placeholders[m].intermediate && instance_index[m] == instance_index[n])
+                return true;
+    }
+
+    return false;
+}
+
+// Move onto the next combination of instances, stepping the first placeholder fastest
+// Returns false (with every placeholder back at its first instance) once every combination has been visited
+bool next_instance_combination(size_t *instance_index, size_t *first_instance, size_t *end_instance, size_t placeholders_count)
+{
+    for (size_t n = 0; n < placeholders_count; n++)
+    {
+        instance_index[n]++;
+
+        if (instance_index[n] < end_instance[n])
+            return true;
+
+        instance_index[n] = first_instance[n];
+    }
+
+    return false;
+}
+
+void create_arcs_from_rule(Constraints *constraints, Rule *rule, QuantumMap *quantum_map)
+{
+    ConversionResult result;
+    INIT_ARRAY(result.variable_references);
+
+    // The arc expression is owned by the constraints' arena
+    Expression *arc_expression = convert_expression(constraints->arena, &result, rule, rule->expression);
+
+    if (result.variable_references_count == 0)
+    {
+        fprintf(stderr, "Internal error: Somehow created an arc that constraints no values");
+        exit(EXIT_FAILURE);
+    }
+
+    // Arcs that constrain a single variable, and only depend on the instance of the placeholder it is accessed through
+    // (an expression that also compares against other placeholders' instances needs arcs for every combination)
+    size_t single_placeholder_index = result.variable_references[0].placeholder_index;
+    if (result.variable_references_count == 1 && only_refers_to_placeholder(arc_expression, single_placeholder_index))
+    {
+        // The rule still only applies if every other placeholder has an instance to take
+        for (size_t n = 0; n < rule->placeholders_count; n++)
+        {
+            if (quantum_map->node_instances_count[rule->placeholders[n].type.node - quantum_map->nodes] == 0)
+                return;
+        }
+
+        // Single arcs only store the one instance
+        set_instance_references(arc_expression, 0);
+
+        Placeholder *placeholder = rule->placeholders + single_placeholder_index;
+        size_t node_index = placeholder->type.node - quantum_map->nodes;
+        RESERVE_ARRAY(constraints->single_arcs, PackedArc, quantum_map->node_instances_count[node_index]);
+        RESERVE_ARRAY(constraints->arc_indexes, size_t, quantum_map->node_instances_count[node_index] * 2);
+
+        size_t family_index = constraints->arc_families_count;
+        ArcFamily *family = EXTEND_ARRAY(constraints->arc_families, ArcFamily);
+        family->expr = arc_expression;
+        family->expr_rotation = 0;
+        family->bytecode = compile_expression(arc_expression, 0, 1, 1);
+        family->mask_bytecode = compile_mask_expression(arc_expression, 0, 1, 1);
+        family->support_table = NULL;
+        family->variables_count = 1;
+        family->instances_count = 1;
+
+        size_t first_instance = quantum_map->node_first_instance[node_index];
+        for (size_t i = first_instance; i < first_instance + quantum_map->node_instances_count[node_index]; i++)
         {
-            size_t n = 0;
-            while (n < total_placeholders)
+            QuantumInstance *instance = quantum_map->instances + i;
+
+            PackedArc *arc = EXTEND_ARRAY(constraints->single_arcs, PackedArc);
+            arc->family_index = family_index;
+            arc->indexes_offset = constraints->arc_indexes_count;
+
+            *EXTEND_ARRAY(constraints->arc_indexes, size_t) = instance->variables_array_index + result.variable_references[0].property_offset;
+            *EXTEND_ARRAY(constraints->arc_indexes, size_t) = i;
+        }
+
+        return;
+    }
+
+    // Arcs that constrain a multiple variables (and thus may have multiple placeholders)
+    // Each placeholder steps through the instances of its node
+    size_t total_placeholders = rule->placeholders_count;
+    size_t *instance_index = (size_t *)malloc(sizeof(size_t) * total_placeholders);
+    size_t *first_instance = (size_t *)malloc(sizeof(size_t) * total_placeholders);
+    size_t *end_instance = (size_t *)malloc(sizeof(size_t) * total_placeholders);
+
+    for (size_t n = 0; n < total_placeholders; n++)
+    {
+        size_t node_index = rule->placeholders[n].type.node - quantum_map->nodes;
+        first_instance[n] = quantum_map->node_first_instance[node_index];
+        end_instance[n] = first_instance[n] + quantum_map->node_instances_count[node_index];
+        instance_index[n] = first_instance[n];
+
+        // A node with no instances means there is nothing for the rule to constrain
+        if (first_instance[n] == end_instance[n])
+        {
+            free(instance_index);
+            free(first_instance);
+            free(end_instance);
+            return;
+        }
+    }
+
+    size_t variables_count = result.variable_references_count;
+    if (variables_count > MAX_ARC_VARIABLES)
+    {
+        fprintf(stderr, "Internal error: We are currently unable to enforce arcs that constrain more than %d variables.", MAX_ARC_VARIABLES);
+        exit(EXIT_FAILURE);
+    }
+
+    // Create a family for each rotation, with the expression compiled for that rotation
+    // (the support tables are created along with the first combination of instances)
+    size_t first_family_index = constraints->arc_families_count;
+    for (size_t rotation = 0; rotation < variables_count; rotation++)
+    {
+        ArcFamily *family = EXTEND_ARRAY(constraints->arc_families, ArcFamily);
+        family->expr = arc_expression;
+        family->expr_rotation = rotation;
+        family->bytecode = compile_expression(arc_expression, rotation, variables_count, total_placeholders);
+        family->mask_bytecode = compile_mask_expression(arc_expression, rotation, variables_count, total_placeholders);
+        family->support_table = NULL;
+        family->variables_count = variables_count;
+        family->instances_count = total_placeholders;
+    }
+
+    bool support_tables_created = false;
+    bool *symmetric = find_symmetric_placeholders(rule);
+
+    // Count the combinations of instances that are given arcs, so that the arcs can be allocated up front
+    // (this leaves every placeholder back at its first instance)
+    size_t combinations_count = 0;
+    do
+    {
+        if (!repeats_instance(rule, instance_index) && !swaps_symmetric_instances(rule, symmetric, instance_index))
+            combinations_count++;
+    } while (next_instance_combination(instance_index, first_instance, end_instance, total_placeholders));
+
+    RESERVE_ARRAY(constraints->multi_arcs, PackedArc, combinations_count * variables_count);
+    RESERVE_ARRAY(constraints->arc_indexes, size_t, combinations_count * (variables_count + total_placeholders));
+
+    do
+    {
+        // Non-intermediate placeholders never refer to the same instance, and swapping the instances of symmetric
+        // placeholders would only create the same arcs again
+        if (!repeats_instance(rule, instance_index) && !swaps_symmetric_instances(rule, symmetric, instance_index))
+        {
+            // Every rotation shares the same variables and instances
+            size_t indexes_offset = constraints->arc_indexes_count;
+            for (size_t v = 0; v < variables_count; v++)
             {
-                instance_index[n]++;
+                VariableReference info = result.variable_references[v];
+                QuantumInstance *instance = quantum_map->instances + instance_index[info.placeholder_index];
+                *EXTEND_ARRAY(constraints->arc_indexes, size_t) = instance->variables_array_index + info.property_offset;
+            }
 
-                if (instance_index[n] < quantum_map->instances_count)
-                    break;
+            for (size_t n = 0; n < total_placeholders; n++)
+                *EXTEND_ARRAY(constraints->arc_indexes, size_t) = instance_index[n];
 
-                instance_index[n] = 0;
-                n++;
+            // Create an arc for each constrained variable
+            for (size_t rotation = 0; rotation < variables_count; rotation++)
+            {
+                PackedArc *arc = EXTEND_ARRAY(constraints->multi_arcs, PackedArc);
+                arc->family_index = first_family_index + rotation;
+                arc->indexes_offset = indexes_offset;
+
+                if (!support_tables_created)
+                {
+                    size_t variable_indexes[MAX_ARC_VARIABLES];
+                    Arc unpacked = unpack_arc(constraints, *arc, variable_indexes);
+                    constraints->arc_families[arc->family_index].support_table = create_support_table(unpacked.bytecode, quantum_map, unpacked.variable_indexes, unpacked.variable_indexes_count);
+                }
             }
 
-            if (n >= total_placeholders)
-                break;
+            support_tables_created = true;
         }
+    } while (next_instance_combination(instance_index, first_instance, end_instance, total_placeholders));
+
+    free(instance_index);
+    free(first_instance);
+    free(end_instance);
+    free(symmetric);
+}
+
+// Index the multi arcs that read each variable
+void index_reading_arcs(Constraints *constraints, QuantumMap *quantum_map)
+{
+    size_t variables_count = quantum_map->variables_count;
+    size_t *offsets = (size_t *)calloc(variables_count + 1, sizeof(size_t));
+
+    // Count the arcs that read each variable
+    size_t variable_indexes[MAX_ARC_VARIABLES];
+    for (size_t a = 0; a < constraints->multi_arcs_count; a++)
+    {
+        Arc arc = unpack_arc(constraints, constraints->multi_arcs[a], variable_indexes);
+        for (size_t n = 1; n < arc.variable_indexes_count; n++)
+            offsets[arc.variable_indexes[n] + 1]++;
     }
+
+    for (size_t v = 0; v < variables_count; v++)
+        offsets[v + 1] += offsets[v];
+
+    // Fill in the arc indexes for each variable
+    size_t *reading_arcs = (size_t *)malloc(sizeof(size_t) * (offsets[variables_count] + 1));
+    size_t *next = (size_t *)malloc(sizeof(size_t) * (variables_count + 1));
+    for (size_t v = 0; v < variables_count; v++)
+        next[v] = offsets[v];
+
+    for (size_t a = 0; a < constraints->multi_arcs_count; a++)
+    {
+        Arc arc = unpack_arc(constraints, constraints->multi_arcs[a], variable_indexes);
+        for (size_t n = 1; n < arc.variable_indexes_count; n++)
+            reading_arcs[next[arc.variable_indexes[n]]++] = a;
+    }
+
+    free(next);
+
+    constraints->reading_arcs_offsets = offsets;
+    constraints->reading_arcs = reading_arcs;
+    constraints->variables_count = variables_count;
 }
 
 Constraints create_constraints(Program *program, QuantumMap *quantum_map)
@@ -264,13 +787,105 @@ Constraints create_constraints(Program *program, QuantumMap *quantum_map)
     Constraints constraints;
     INIT_ARRAY(constraints.single_arcs);
     INIT_ARRAY(constraints.multi_arcs);
+    INIT_ARRAY(constraints.arc_families);
+    INIT_ARRAY(constraints.arc_indexes);
+    INIT_ARRAY(constraints.channels);
+    constraints.arena = create_arena(ARENA_BLOCK_SIZE);
+
+    bool *rule_is_covered = (bool *)calloc(program->rules_count + 1, sizeof(bool));
+    create_all_differents(&constraints, program, quantum_map, rule_is_covered);
 
     for (size_t i = 0; i < program->rules_count; i++)
-        create_arcs_from_rule(&constraints, program->rules + i, quantum_map);
+    {
+        Rule *rule = program->rules + i;
+        if (rule_is_covered[i])
+            continue;
+
+        if (!create_channel_from_rule(&constraints, program, rule))
+            create_arcs_from_rule(&constraints, rule, quantum_map);
+    }
+
+    free(rule_is_covered);
+
+    index_reading_arcs(&constraints, quantum_map);
+    create_channel_watches(&constraints, quantum_map);
 
     return constraints;
 }
 
+// Arcs
+Arc unpack_arc(Constraints *constraints, PackedArc packed, size_t *variable_indexes)
+{
+    ArcFamily *family = constraints->arc_families + packed.family_index;
+    size_t *indexes = constraints->arc_indexes + packed.indexes_offset;
+    size_t count = family->variables_count;
+
+    // The variable the expression refers to as `v` is at `(v + rotation) % count` in the arc
+    for (size_t v = 0; v < count; v++)
+        variable_indexes[(v + family->expr_rotation) % count] = indexes[v];
+
+    Arc arc;
+    arc.instance_indexes = indexes + count;
+    arc.instance_indexes_count = family->instances_count;
+    arc.variable_indexes = variable_indexes;
+    arc.variable_indexes_count = count;
+    arc.expr_rotation = family->expr_rotation;
+    arc.expr = family->expr;
+    arc.bytecode = family->bytecode;
+    arc.mask_bytecode = family->mask_bytecode;
+    arc.support_table = family->support_table;
+    return arc;
+}
+
+size_t *packed_arc_variables(Constraints *constraints, PackedArc packed)
+{
+    return constraints->arc_indexes + packed.indexes_offset;
+}
+
+size_t packed_arc_variables_count(Constraints *constraints, PackedArc packed)
+{
+    return constraints->arc_families[packed.family_index].variables_count;
+}
+
+// Arcs that read a variable
+size_t reading_arcs_count(Constraints *constraints, size_t var_index)
+{
+    return constraints->reading_arcs_offsets[var_index + 1] - constraints->reading_arcs_offsets[var_index];
+}
+
+size_t *reading_arcs_of(Constraints *constraints, size_t var_index)
+{
+    return constraints->reading_arcs + constraints->reading_arcs_offsets[var_index];
+}
+
+// Channels
+size_t channel_variable(Channel *channel, QuantumMap *quantum_map, size_t instance_index, bool inverse)
+{
+    size_t property_offset = inverse ? channel->inverse_property_offset : channel->forward_property_offset;
+    return quantum_map->instances[instance_index].variables_array_index + property_offset;
+}
+
+size_t variable_watches_count(Constraints *constraints, size_t var_index)
+{
+    return constraints->variable_watches_offsets[var_index + 1] - constraints->variable_watches_offsets[var_index];
+}
+
+size_t *variable_watches_of(Constraints *constraints, size_t var_index)
+{
+    return constraints->variable_watches + constraints->variable_watches_offsets[var_index];
+}
+
+// All different constraints
+size_t variable_all_differents_count(Constraints *constraints, size_t var_index)
+{
+    return constraints->variable_all_differents_offsets[var_index + 1] - constraints->variable_all_differents_offsets[var_index];
+}
+
+size_t *variable_all_differents_of(Constraints *constraints, size_t var_index)
+{
+    return constraints->variable_all_differents + constraints->variable_all_differents_offsets[var_index];
+}
+
 // Printing & strings
 void print_arc(Arc *arc)
 {
@@ -280,17 +895,55 @@ void print_arc(Arc *arc)
     print_expression(arc->expr);
 }
 
+void print_reading_arcs(Constraints constraints)
+{
+    for (size_t v = 0; v < constraints.variables_count; v++)
+    {
+        size_t count = reading_arcs_count(&constraints, v);
+        if (count == 0)
+            continue;
+
+        size_t *arcs = reading_arcs_of(&constraints, v);
+        printf("%03d read by", v);
+        for (size_t i = 0; i < count; i++)
+            printf(" #%d", arcs[i]);
+        printf("\n");
+    }
+}
+
 void print_constraints(Constraints constraints)
 {
+    size_t variable_indexes[MAX_ARC_VARIABLES];
     for (size_t i = 0; i < constraints.single_arcs_count; i++)
     {
-        print_arc(constraints.single_arcs + i);
+        Arc arc = unpack_arc(&constraints, constraints.single_arcs[i], variable_indexes);
+        print_arc(&arc);
         printf("\n");
     }
 
     for (size_t i = 0; i < constraints.multi_arcs_count; i++)
     {
-        print_arc(constraints.multi_arcs + i);
+        Arc arc = unpack_arc(&constraints, constraints.multi_arcs[i], variable_indexes);
+        printf("#%d ", i);
+        print_arc(&arc);
         printf("\n");
     }
+
+    for (size_t i = 0; i < constraints.channels_count; i++)
+    {
+        Channel *channel = constraints.channels + i;
+        printf("channel %d: node %d property %d <-> node %d property %d\n", i, channel->forward_node_index, channel->forward_property_offset, channel->inverse_node_index, channel->inverse_property_offset);
+    }
+
+    for (size_t i = 0; i < constraints.all_differents_count; i++)
+    {
+        AllDifferent *all_different = constraints.all_differents + i;
+        printf("all different %d:", i);
+        for (size_t n = 0; n < all_different->variable_indexes_count; n++)
+            printf(" %03d", all_different->variable_indexes[n]);
+        printf("\n");
+    }
+
+    printf("\n");
+    print_reading_arcs(constraints);
 }
\ No newline at end of file
@@ -1,15 +1,21 @@
 #ifndef CONSTRAINTS_H
 #define CONSTRAINTS_H
 
+#include <stdbool.h>
 #include <stdlib.h>
 
+#include "arena.h"
+#include "bytecode.h"
 #include "expression.h"
 #include "program.h"
 #include "quantum_map.h"
+#include "support_table.h"
 
 // CLEANUP: Split data structure and `create_constraints` into separate source files.
 
 // Arc
+// An arc as it is revised, with its variables in the order of its rotation (i.e. its primary variable first).
+// Arcs are not stored like this (see `PackedArc`), but are unpacked from the constraints when they are needed.
 typedef struct
 {
     size_t *instance_indexes;
@@ -18,20 +24,142 @@ typedef struct
     size_t variable_indexes_count;
     size_t expr_rotation;
     Expression *expr;
+    Bytecode *bytecode; // The expression compiled for the arc's rotation
+    MaskBytecode *mask_bytecode; // NULL if the expression cannot be compiled to exact masks
+    SupportTable *support_table; // NULL if the expression reads the arc's instances
 } Arc;
 
+// The most variables an arc can constrain
+#define MAX_ARC_VARIABLES 16
+
+// ArcFamily
+// Everything that is the same for every arc created from a rule with the same rotation
+typedef struct
+{
+    Expression *expr;
+    size_t expr_rotation;
+    Bytecode *bytecode;
+    MaskBytecode *mask_bytecode;
+    SupportTable *support_table;
+    size_t variables_count;
+    size_t instances_count;
+} ArcFamily;
+
+// PackedArc
+// The variables and instances of each combination of instances that a rule is applied to are stored once, one after
+// another in the constraints' `arc_indexes` (variables first, in the order the rule's expression refers to them).
+// Every rotation of the combination is an arc of a different family that points at the same indexes.
+typedef struct
+{
+    size_t family_index;
+    size_t indexes_offset;
+} PackedArc;
+
+// Channel
+// A rule such as `FOR X x: x.forward.inverse = x` is resolved into `(~inverse != x.forward) OR (~inverse.inverse = x)`
+// (where `~inverse` is an intermediate placeholder). That is, for every instance `y` that `x.forward` could refer to,
+// `x.forward = y` implies `y.inverse = x`. Rather than creating arcs for every pair of `x` and `y` (which are then
+// revised against every `y` whenever anything changes), the rule is enforced directly between the `forward` variable
+// of each `x` and the `inverse` variable of each `y`. The two properties can be on different nodes, or be the same
+// property (e.g. `x.buddy.buddy = x`).
+typedef struct
+{
+    size_t forward_node_index; // Index of the node of `x`
+    size_t forward_property_offset;
+    size_t inverse_node_index; // Index of the node of `y` (the node that `forward` refers to)
+    size_t inverse_property_offset;
+} Channel;
+
+// ChannelWatch
+// A variable of a channel, which is revised from that variable's side whenever the variable is narrowed
+typedef struct
+{
+    size_t channel_index;
+    size_t instance_index; // `x` if the variable is `x.forward`, or `y` if it is `y.inverse`
+    bool inverse;
+} ChannelWatch;
+
+// AllDifferent
+// A family of rules such as `FOR X x X y: x.p != y.p`, which together say that no two of a set of variables can take
+// the same value. Rather than creating an arc for every pair of variables (which can only remove a value once the
+// other variable has been collapsed to it), the family is enforced as a single constraint (see "all_different.h").
+typedef struct
+{
+    size_t *variable_indexes;
+    size_t variable_indexes_count;
+    size_t variable_indexes_capacity;
+    int min_value;       // The smallest value any of the variables could take
+    size_t values_count; // The number of values from `min_value` to the largest value any of the variables could take
+} AllDifferent;
+
 // Constraints
 typedef struct
 {
-    Arc *single_arcs;
+    PackedArc *single_arcs;
     size_t single_arcs_count;
-    Arc *multi_arcs;
+    size_t single_arcs_capacity;
+    PackedArc *multi_arcs;
     size_t multi_arcs_count;
+    size_t multi_arcs_capacity;
+
+    ArcFamily *arc_families;
+    size_t arc_families_count;
+    size_t arc_families_capacity;
+    size_t *arc_indexes;
+    size_t arc_indexes_count;
+    size_t arc_indexes_capacity;
+
+    // Multi arcs that read each variable, stored as one array of arc indexes that is sliced by
+    // `reading_arcs_offsets` (which has `variables_count + 1` entries). An arc only ever narrows
+    // its primary variable, so it reads every variable it constrains except for the first.
+    size_t *reading_arcs_offsets;
+    size_t *reading_arcs;
+    size_t variables_count;
+
+    Channel *channels;
+    size_t channels_count;
+    size_t channels_capacity;
+    ChannelWatch *channel_watches;
+    size_t channel_watches_count;
+    size_t channel_watches_capacity;
+
+    // Channel watches of each variable, sliced in the same way as `reading_arcs`
+    size_t *variable_watches_offsets;
+    size_t *variable_watches;
+
+    AllDifferent *all_differents;
+    size_t all_differents_count;
+    size_t all_differents_capacity;
+
+    // All different constraints on each variable, sliced in the same way as `reading_arcs`
+    size_t *variable_all_differents_offsets;
+    size_t *variable_all_differents;
+
+    Arena *arena; // The expression of every arc
 } Constraints;
 
 // Create constraints
 Constraints create_constraints(Program *program, QuantumMap *quantum_map);
 
+// Arcs
+// `variable_indexes` must have room for `MAX_ARC_VARIABLES` variables
+Arc unpack_arc(Constraints *constraints, PackedArc packed, size_t *variable_indexes);
+size_t *packed_arc_variables(Constraints *constraints, PackedArc packed); // In the order of the rule's expression
+size_t packed_arc_variables_count(Constraints *constraints, PackedArc packed);
+
+// Arcs that read a variable
+size_t reading_arcs_count(Constraints *constraints, size_t var_index);
+size_t *reading_arcs_of(Constraints *constraints, size_t var_index);
+
+// Channels
+size_t channel_variable(Channel *channel, QuantumMap *quantum_map, size_t instance_index, bool inverse);
+size_t variable_watches_count(Constraints *constraints, size_t var_index);
+size_t *variable_watches_of(Constraints *constraints, size_t var_index);
+
+// All different constraints
+size_t variable_all_differents_count(Constraints *constraints, size_t var_index);
+size_t *variable_all_differents_of(Constraints *constraints, size_t var_index);
+
 // Printing & strings
 void print_arc(Arc *arc);
 void print_constraints(Constraints constraints);
@@ -0,0 +1,350 @@
+#include <stdio.h>
+
+#include "domain.h"
+
+// Bounds
+#define BOUNDS_MIN(domain) ((int64_t)(domain).words[0])
+#define BOUNDS_MAX(domain) ((int64_t)(domain).words[1])
+
+void set_domain_bounds(Domain domain, int64_t min, int64_t max)
+{
+    domain.words[0] = (uint64_t)min;
+    domain.words[1] = (uint64_t)max;
+}
+
+// Words
+size_t words_for_values(size_t values_count)
+{
+    size_t words_count = (values_count + 63) / 64;
+    return words_count == 0 ? 1 : words_count;
+}
+
+// Querying domains
+bool domain_contains(Domain domain, int value)
+{
+    if (domain.kind == DOMAIN_KIND__BOUNDS)
+        return value >= BOUNDS_MIN(domain) && value <= BOUNDS_MAX(domain);
+
+    if (value < domain.base)
+        return false;
+
+    size_t bit = (size_t)(value - domain.base);
+    if (bit >= domain.words_count * 64)
+        return false;
+
+    return (domain.words[bit / 64] & (1ULL << (bit % 64))) != 0;
+}
+
+bool domain_is_empty(Domain domain)
+{
+    if (domain.kind == DOMAIN_KIND__BOUNDS)
+        return BOUNDS_MIN(domain) > BOUNDS_MAX(domain);
+
+    uint64_t any = 0;
+    for (size_t w = 0; w < domain.words_count; w++)
+        any |= domain.words[w];
+
+    return any == 0;
+}
+
+bool domain_has_one_value(Domain domain)
+{
+    if (domain.kind == DOMAIN_KIND__BOUNDS)
+        return BOUNDS_MIN(domain) == BOUNDS_MAX(domain);
+
+    bool found = false;
+    for (size_t w = 0; w < domain.words_count; w++)
+    {
+        uint64_t word = domain.words[w];
+        if (word == 0)
+            continue;
+
+        // More than one bit is set in this word, or a bit was set in an earlier word
+        if (found || (word & (word - 1)) != 0)
+            return false;
+
+        found = true;
+    }
+
+    return found;
+}
+
+bool domains_are_equal(Domain a, Domain b)
+{
+    for (size_t w = 0; w < a.words_count; w++)
+        if (a.words[w] != b.words[w])
+            return false;
+
+    return true;
+}
+
+// Returns true if every value of `domain` is also a value of `other`
+// NOTE: This assumes both domains are the same kind, and have the same base and number of words
+bool domain_is_subset(Domain domain, Domain other)
+{
+    if (domain.kind == DOMAIN_KIND__BOUNDS)
+        return domain_is_empty(domain) || (BOUNDS_MIN(domain) >= BOUNDS_MIN(other) && BOUNDS_MAX(domain) <= BOUNDS_MAX(other));
+
+    for (size_t w = 0; w < domain.words_count; w++)
+        if (domain.words[w] & ~other.words[w])
+            return false;
+
+    return true;
+}
+
+size_t count_domain_values(Domain domain)
+{
+    if (domain.kind == DOMAIN_KIND__BOUNDS)
+        return domain_is_empty(domain) ? 0 : (size_t)(BOUNDS_MAX(domain) - BOUNDS_MIN(domain) + 1);
+
+    size_t count = 0;
+    for (size_t w = 0; w < domain.words_count; w++)
+        count += __builtin_popcountll(domain.words[w]);
+
+    return count;
+}
+
+// Iterating over domains
+// Returns NO_VALUE if there is no such value
+
+int first_domain_value(Domain domain)
+{
+    if (domain.kind == DOMAIN_KIND__BOUNDS)
+        return domain_is_empty(domain) ? NO_VALUE : (int)BOUNDS_MIN(domain);
+
+    for (size_t w = 0; w < domain.words_count; w++)
+        if (domain.words[w] != 0)
+            return domain.base + (int)(w * 64 + __builtin_ctzll(domain.words[w]));
+
+    return NO_VALUE;
+}
+
+int domain_value_after(Domain domain, int value)
+{
+    if (domain.kind == DOMAIN_KIND__BOUNDS)
+    {
+        if (value < BOUNDS_MIN(domain))
+            return first_domain_value(domain);
+
+        return (int64_t)value < BOUNDS_MAX(domain) ? value + 1 : NO_VALUE;
+    }
+
+    size_t bit = value < domain.base ? 0 : (size_t)(value - domain.base) + 1;
+    size_t w = bit / 64;
+    if (w >= domain.words_count)
+        return NO_VALUE;
+
+    // Check the rest of the word the value is in, and then every word after it
+    uint64_t word = bit % 64 == 0 ? domain.words[w] : domain.words[w] & (UINT64_MAX << (bit % 64));
+    while (true)
+    {
+        if (word != 0)
+            return domain.base + (int)(w * 64 + __builtin_ctzll(word));
+
+        w++;
+        if (w >= domain.words_count)
+            return NO_VALUE;
+
+        word = domain.words[w];
+    }
+}
+
+int last_domain_value(Domain domain)
+{
+    if (domain.kind == DOMAIN_KIND__BOUNDS)
+        return domain_is_empty(domain) ? NO_VALUE : (int)BOUNDS_MAX(domain);
+
+    for (size_t w = domain.words_count; w > 0; w--)
+        if (domain.words[w - 1] != 0)
+            return domain.base + (int)((w - 1) * 64 + 63 - __builtin_clzll(domain.words[w - 1]));
+
+    return NO_VALUE;
+}
+
+// Pick a value from the domain, using `random` to decide which
+int pick_domain_value(Domain domain, size_t random)
+{
+    size_t count = count_domain_values(domain);
+    if (count == 0)
+        return NO_VALUE;
+
+    size_t n = random % count;
+    if (domain.kind == DOMAIN_KIND__BOUNDS)
+        return (int)(BOUNDS_MIN(domain) + (int64_t)n);
+
+    for (size_t w = 0; w < domain.words_count; w++)
+    {
+        uint64_t word = domain.words[w];
+        size_t word_count = __builtin_popcountll(word);
+        if (n >= word_count)
+        {
+            n -= word_count;
+            continue;
+        }
+
+        // Clear the lowest `n` set bits of the word, leaving the value we want as the lowest set bit
+        for (size_t i = 0; i < n; i++)
+            word &= word - 1;
+
+        return domain.base + (int)(w * 64 + __builtin_ctzll(word));
+    }
+
+    return NO_VALUE;
+}
+
+// Modifying domains
+void clear_domain(Domain domain)
+{
+    if (domain.kind == DOMAIN_KIND__BOUNDS)
+    {
+        set_domain_bounds(domain, 1, 0);
+        return;
+    }
+
+    for (size_t w = 0; w < domain.words_count; w++)
+        domain.words[w] = 0;
+}
+
+// Set the domain to contain the first `values_count` values
+void fill_domain(Domain domain, size_t values_count)
+{
+    if (domain.kind == DOMAIN_KIND__BOUNDS)
+    {
+        set_domain_bounds(domain, domain.base, (int64_t)domain.base + (int64_t)values_count - 1);
+        return;
+    }
+
+    for (size_t w = 0; w < domain.words_count; w++)
+    {
+        if (values_count >= (w + 1) * 64)
+            domain.words[w] = UINT64_MAX;
+        else if (values_count <= w * 64)
+            domain.words[w] = 0;
+        else
+            domain.words[w] = UINT64_MAX >> (64 - (values_count - w * 64));
+    }
+}
+
+void copy_domain(Domain destination, Domain source)
+{
+    for (size_t w = 0; w < destination.words_count; w++)
+        destination.words[w] = source.words[w];
+}
+
+// NOTE: Adding a value to a bounds domain also adds every value between it and the existing values
+void add_domain_value(Domain domain, int value)
+{
+    if (domain.kind == DOMAIN_KIND__BOUNDS)
+    {
+        if (domain_is_empty(domain))
+            set_domain_bounds(domain, value, value);
+        else if (value < BOUNDS_MIN(domain))
+            set_domain_bounds(domain, value, BOUNDS_MAX(domain));
+        else if (value > BOUNDS_MAX(domain))
+            set_domain_bounds(domain, BOUNDS_MIN(domain), value);
+        return;
+    }
+
+    size_t bit = (size_t)(value - domain.base);
+    domain.words[bit / 64] |= 1ULL << (bit % 64);
+}
+
+// NOTE: Only the smallest or largest value can be removed from a bounds domain. Removing any other
+//       value leaves the domain as it is.
+void remove_domain_value(Domain domain, int value)
+{
+    if (!domain_contains(domain, value))
+        return;
+
+    if (domain.kind == DOMAIN_KIND__BOUNDS)
+    {
+        if (value == BOUNDS_MIN(domain))
+            set_domain_bounds(domain, BOUNDS_MIN(domain) + 1, BOUNDS_MAX(domain));
+        else if (value == BOUNDS_MAX(domain))
+            set_domain_bounds(domain, BOUNDS_MIN(domain), BOUNDS_MAX(domain) - 1);
+        return;
+    }
+
+    size_t bit = (size_t)(value - domain.base);
+    domain.words[bit / 64] &= ~(1ULL << (bit % 64));
+}
+
+// NOTE: This assumes both domains are the same kind, and have the same base and number of words
+void intersect_domains(Domain domain, Domain other)
+{
+    if (domain.kind == DOMAIN_KIND__BOUNDS)
+    {
+        int64_t min = BOUNDS_MIN(domain) > BOUNDS_MIN(other) ? BOUNDS_MIN(domain) : BOUNDS_MIN(other);
+        int64_t max = BOUNDS_MAX(domain) < BOUNDS_MAX(other) ? BOUNDS_MAX(domain) : BOUNDS_MAX(other);
+        set_domain_bounds(domain, min, max);
+        return;
+    }
+
+    for (size_t w = 0; w < domain.words_count; w++)
+        domain.words[w] &= other.words[w];
+}
+
+// NOTE: These only work on bitfields. The complement of a domain also contains values past the last
+//       value the variable could ever take, so it should be intersected with a real domain before use.
+void union_domains(Domain domain, Domain other)
+{
+    for (size_t w = 0; w < domain.words_count; w++)
+        domain.words[w] |= other.words[w];
+}
+
+// Remove every value of `other` from the domain
+void subtract_domains(Domain domain, Domain other)
+{
+    for (size_t w = 0; w < domain.words_count; w++)
+        domain.words[w] &= ~other.words[w];
+}
+
+void complement_domain(Domain domain)
+{
+    for (size_t w = 0; w < domain.words_count; w++)
+        domain.words[w] = ~domain.words[w];
+}
+
+// Set the domain to contain every value from `min` to `max` (that the domain's bits can represent)
+void set_domain_range(Domain domain, int64_t min, int64_t max)
+{
+    int64_t last_bit = (int64_t)domain.words_count * 64 - 1;
+    int64_t first = min < domain.base ? 0 : min - domain.base;
+    int64_t last = max > domain.base + last_bit ? last_bit : max - domain.base;
+
+    for (size_t w = 0; w < domain.words_count; w++)
+    {
+        int64_t word_first = (int64_t)w * 64;
+        int64_t word_last = word_first + 63;
+
+        if (last < word_first || first > word_last)
+        {
+            domain.words[w] = 0;
+            continue;
+        }
+
+        uint64_t word = UINT64_MAX;
+        if (first > word_first)
+            word &= UINT64_MAX << (first - word_first);
+        if (last < word_last)
+            word &= UINT64_MAX >> (word_last - last);
+
+        domain.words[w] = word;
+    }
+}
+
+// Printing & strings
+void print_domain(Domain domain, size_t values_count)
+{
+    if (domain.kind == DOMAIN_KIND__BOUNDS)
+    {
+        if (domain_is_empty(domain))
+            printf("[]");
+        else
+            printf("[%lld..%lld]", (long long)BOUNDS_MIN(domain), (long long)BOUNDS_MAX(domain));
+        return;
+    }
+
+    for (size_t i = values_count; i > 0; i--)
+        putchar(domain_contains(domain, domain.base + (int)(i - 1)) ? '1' : '0');
+}
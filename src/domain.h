@@ -0,0 +1,73 @@
+#ifndef DOMAIN_H
+#define DOMAIN_H
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// DomainKind
+typedef enum
+{
+    // The set of values a variable could take, stored as a bitfield spanning one or more 64-bit words.
+    // Bit `n` of the domain represents the value `base + n`. Bits past the last value the variable could
+    // ever take are never set, so the words of a domain can be combined without masking the last word.
+    DOMAIN_KIND__BITFIELD,
+
+    // The smallest and largest value a variable could take, stored in the first two words (as int64_t).
+    // Every value in between is assumed to be possible, so values can only be removed from either end.
+    // This is used for ranges that are too large to store as a bitfield.
+    DOMAIN_KIND__BOUNDS,
+} DomainKind;
+
+#define BOUNDS_WORDS_COUNT 2
+
+// Domain
+// CLEANUP: Domains are views onto words owned by something else (usually the quantum map).
+//          Is there a better name for this struct, to make that clearer?
+typedef struct
+{
+    DomainKind kind;
+    uint64_t *words;
+    size_t words_count;
+    int base;
+} Domain;
+
+#define NO_VALUE INT_MIN
+
+// Bounds
+void set_domain_bounds(Domain domain, int64_t min, int64_t max);
+
+// Words
+size_t words_for_values(size_t values_count);
+
+// Querying domains
+bool domain_contains(Domain domain, int value);
+bool domain_is_empty(Domain domain);
+bool domain_has_one_value(Domain domain);
+bool domains_are_equal(Domain a, Domain b);
+bool domain_is_subset(Domain domain, Domain other);
+size_t count_domain_values(Domain domain);
+
+// Iterating over domains
+int first_domain_value(Domain domain);
+int domain_value_after(Domain domain, int value);
+int last_domain_value(Domain domain);
+int pick_domain_value(Domain domain, size_t random);
+
+// Modifying domains
+void clear_domain(Domain domain);
+void fill_domain(Domain domain, size_t values_count);
+void copy_domain(Domain destination, Domain source);
+void add_domain_value(Domain domain, int value);
+void remove_domain_value(Domain domain, int value);
+void intersect_domains(Domain domain, Domain other);
+void union_domains(Domain domain, Domain other);
+void subtract_domains(Domain domain, Domain other);
+void complement_domain(Domain domain);
+void set_domain_range(Domain domain, int64_t min, int64_t max);
+
+// Printing & strings
+void print_domain(Domain domain, size_t values_count);
+
+#endif
\ No newline at end of file
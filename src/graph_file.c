@@ -0,0 +1,247 @@
+#include <string.h>
+
+#ifdef _WIN32
+// NOTE: wingdi.h declares functions (e.g. `Arc`) with the same names as our types
+#define WIN32_LEAN_AND_MEAN
+#define NOGDI
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "graph_file.h"
+#include "memory.h"
+
+// Mapping graph files
+bool map_graph_file(const char *path, GraphFile *file)
+{
+#ifdef _WIN32
+    HANDLE file_handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file_handle == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file_handle, &size))
+    {
+        CloseHandle(file_handle);
+        return false;
+    }
+
+    // An empty file cannot be mapped, but is still a valid graph file (with no graphs)
+    if (size.QuadPart == 0)
+    {
+        CloseHandle(file_handle);
+        file->view = NULL;
+        file->size = 0;
+        file->file_handle = NULL;
+        file->mapping_handle = NULL;
+        return true;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL)
+    {
+        CloseHandle(file_handle);
+        return false;
+    }
+
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == NULL)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file_handle);
+        return false;
+    }
+
+    file->view = (uint8_t *)view;
+    file->size = (size_t)size.QuadPart;
+    file->file_handle = file_handle;
+    file->mapping_handle = mapping;
+    return true;
+#else
+    int file_descriptor = open(path, O_RDONLY);
+    if (file_descriptor < 0)
+        return false;
+
+    struct stat file_stat;
+    if (fstat(file_descriptor, &file_stat) != 0)
+    {
+        close(file_descriptor);
+        return false;
+    }
+
+    // An empty file cannot be mapped, but is still a valid graph file (with no graphs)
+    if (file_stat.st_size == 0)
+    {
+        close(file_descriptor);
+        file->view = NULL;
+        file->size = 0;
+        return true;
+    }
+
+    void *view = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_SHARED, file_descriptor, 0);
+    close(file_descriptor); // The mapping stays valid once the file is closed
+    if (view == MAP_FAILED)
+        return false;
+
+    file->view = (uint8_t *)view;
+    file->size = (size_t)file_stat.st_size;
+    return true;
+#endif
+}
+
+void unmap_graph_file(GraphFile *file)
+{
+    if (file->view == NULL)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(file->view);
+    CloseHandle(file->mapping_handle);
+    CloseHandle(file->file_handle);
+#else
+    munmap(file->view, file->size);
+#endif
+}
+
+// Validating graphs
+// NOTE: Every offset, table and edge offset is checked, so that reading a graph never goes outside the file. The edges'
+//       targets and the columns' values are not, as checking them would mean reading the whole file.
+bool section_fits(uint64_t offset, uint64_t count, uint64_t element_size, uint64_t size)
+{
+    return offset % 8 == 0 && offset <= size && count <= (size - offset) / element_size;
+}
+
+bool valid_graph(uint8_t *start, uint64_t available_size)
+{
+    if (available_size < sizeof(GraphHeader))
+        return false;
+
+    GraphHeader *header = (GraphHeader *)start;
+    if (memcmp(header->magic, GRAPH_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != GRAPH_FILE_VERSION ||
+        header->size % 8 != 0 || header->size < sizeof(GraphHeader) || header->size > available_size)
+        return false;
+
+    uint64_t size = header->size;
+    if (!section_fits(header->types_offset, header->types_count, sizeof(GraphType), size) ||
+        header->instances_count == UINT64_MAX ||
+        !section_fits(header->edge_offsets_offset, header->instances_count + 1, sizeof(uint64_t), size) ||
+        !section_fits(header->edge_targets_offset, header->edges_count, sizeof(uint32_t), size) ||
+        !section_fits(header->edge_properties_offset, header->edges_count, sizeof(uint32_t), size))
+        return false;
+
+    GraphType *types = (GraphType *)(start + header->types_offset);
+    for (uint32_t t = 0; t < header->types_count; t++)
+    {
+        GraphType *type = types + t;
+        if (!section_fits(type->properties_offset, type->properties_count, sizeof(GraphProperty), size) ||
+            type->name_offset > size || type->name_length > size - type->name_offset ||
+            type->first_instance > header->instances_count || type->instances_count > header->instances_count - type->first_instance)
+            return false;
+
+        GraphProperty *properties = (GraphProperty *)(start + type->properties_offset);
+        for (uint32_t p = 0; p < type->properties_count; p++)
+        {
+            GraphProperty *property = properties + p;
+            if (property->name_offset > size || property->name_length > size - property->name_offset)
+                return false;
+
+            if (property->type == GRAPH_PROPERTY_TYPE__NODE)
+            {
+                if (property->target_type >= header->types_count)
+                    return false;
+            }
+            else if (!section_fits(property->column_offset, type->instances_count, sizeof(int32_t), size))
+                return false;
+        }
+    }
+
+    // The edges of each instance must come after the edges of the one before it
+    uint64_t *edge_offsets = (uint64_t *)(start + header->edge_offsets_offset);
+    if (edge_offsets[0] != 0 || edge_offsets[header->instances_count] != header->edges_count)
+        return false;
+
+    for (uint64_t i = 0; i < header->instances_count; i++)
+    {
+        if (edge_offsets[i + 1] < edge_offsets[i])
+            return false;
+    }
+
+    return true;
+}
+
+// Open graph file
+bool open_graph_file(const char *path, GraphFile *file)
+{
+    if (!map_graph_file(path, file))
+        return false;
+
+    // Graphs are found by following each one's size to the next
+    INIT_ARRAY(file->graphs);
+    size_t offset = 0;
+    while (offset < file->size)
+    {
+        if (!valid_graph(file->view + offset, file->size - offset))
+        {
+            close_graph_file(file);
+            return false;
+        }
+
+        GraphHeader *header = (GraphHeader *)(file->view + offset);
+        *EXTEND_ARRAY(file->graphs, GraphHeader *) = header;
+        offset += header->size;
+    }
+
+    return true;
+}
+
+void close_graph_file(GraphFile *file)
+{
+    free(file->graphs);
+    unmap_graph_file(file);
+}
+
+// Graphs
+Graph get_graph(GraphFile *file, size_t graph_index)
+{
+    GraphHeader *header = file->graphs[graph_index];
+    uint8_t *start = (uint8_t *)header;
+
+    Graph graph;
+    graph.header = header;
+    graph.types = (GraphType *)(start + header->types_offset);
+    graph.edge_offsets = (uint64_t *)(start + header->edge_offsets_offset);
+    graph.edge_targets = (uint32_t *)(start + header->edge_targets_offset);
+    graph.edge_properties = (uint32_t *)(start + header->edge_properties_offset);
+    return graph;
+}
+
+GraphProperty *get_graph_properties(Graph graph, GraphType *type)
+{
+    return (GraphProperty *)((uint8_t *)graph.header + type->properties_offset);
+}
+
+const char *get_graph_name(Graph graph, uint64_t name_offset)
+{
+    return (const char *)graph.header + name_offset;
+}
+
+int32_t *get_graph_column(Graph graph, GraphProperty *property)
+{
+    return (int32_t *)((uint8_t *)graph.header + property->column_offset);
+}
+
+uint32_t *get_graph_edges(Graph graph, uint64_t instance, uint64_t *edges_count)
+{
+    *edges_count = graph.edge_offsets[instance + 1] - graph.edge_offsets[instance];
+    return graph.edge_targets + graph.edge_offsets[instance];
+}
+
+uint32_t *get_graph_edge_properties(Graph graph, uint64_t instance)
+{
+    return graph.edge_properties + graph.edge_offsets[instance];
+}
\ No newline at end of file
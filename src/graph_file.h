@@ -0,0 +1,117 @@
+#ifndef GRAPH_FILE_H
+#define GRAPH_FILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Graph files
+// A compact binary form of collapsed maps (written with `-csr`), for programs that load large generated graphs and
+// would otherwise spend most of their time parsing text. A file holds one graph per sample, back to back, and can be
+// mapped into memory and read where it is, without being parsed or copied.
+//
+// Each graph is laid out as:
+//   GraphHeader
+//   GraphType[types_count]          One per node, with the range of instance IDs its instances take
+//   GraphProperty[...]              The properties of every type, one type after another
+//   int32_t[...]                    One column per `num` or `bool` property, holding its value for each instance of the type
+//   uint64_t[instances_count + 1]   Edge offsets (the edges of instance `i` are edges[offsets[i]] up to edges[offsets[i + 1]])
+//   uint32_t[edges_count]           Edge targets (the ID of the instance each node property refers to)
+//   uint32_t[edges_count]           Edge properties (the index, in its type, of the property each edge comes from)
+//   char[...]                       Names (not null terminated)
+//
+// Every offset is in bytes from the start of the graph's header, every section starts on an 8 byte boundary, and the
+// size of each graph is a multiple of 8, so every value can be read in place.
+#define GRAPH_FILE_VERSION 1
+
+#define GRAPH_FILE_MAGIC "SUNGRAPH"
+
+// GraphPropertyType
+typedef enum
+{
+    GRAPH_PROPERTY_TYPE__NUMBER,
+    GRAPH_PROPERTY_TYPE__BOOL,
+    GRAPH_PROPERTY_TYPE__NODE,
+} GraphPropertyType;
+
+// GraphHeader
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t types_count;
+    uint64_t size; // The size of the whole graph, so the offset of the next graph in the file
+    uint64_t sample;
+    uint64_t instances_count;
+    uint64_t edges_count;
+    uint64_t types_offset;
+    uint64_t edge_offsets_offset;
+    uint64_t edge_targets_offset;
+    uint64_t edge_properties_offset;
+} GraphHeader;
+
+// GraphType
+typedef struct
+{
+    uint64_t name_offset;
+    uint32_t name_length;
+    uint32_t properties_count;
+    uint64_t properties_offset;
+    uint64_t first_instance; // The instances of a type take consecutive IDs
+    uint64_t instances_count;
+} GraphType;
+
+// GraphProperty
+typedef struct
+{
+    uint64_t name_offset;
+    uint32_t name_length;
+    uint32_t type;        // GraphPropertyType
+    uint32_t target_type; // The index of the type a `NODE` property refers to
+    uint32_t edge_index;  // The index of the property among its type's `NODE` properties
+    uint64_t column_offset; // The property's column, for `NUMBER` and `BOOL` properties
+} GraphProperty;
+
+// Reading graph files
+// GraphFile
+typedef struct
+{
+    uint8_t *view; // Where the file is mapped
+    size_t size;
+#ifdef _WIN32
+    void *file_handle;
+    void *mapping_handle;
+#endif
+
+    GraphHeader **graphs;
+    size_t graphs_count;
+    size_t graphs_capacity;
+} GraphFile;
+
+// Returns false if the file cannot be mapped, or is not a valid graph file (an empty file is valid, with no graphs)
+// NOTE: Every offset in a graph is checked, but the values in its columns and the targets of its edges are not
+bool open_graph_file(const char *path, GraphFile *file);
+void close_graph_file(GraphFile *file);
+
+// Graph
+// A graph from a graph file, with its sections found
+typedef struct
+{
+    GraphHeader *header;
+    GraphType *types;
+    uint64_t *edge_offsets;
+    uint32_t *edge_targets;
+    uint32_t *edge_properties;
+} Graph;
+
+Graph get_graph(GraphFile *file, size_t graph_index);
+
+GraphProperty *get_graph_properties(Graph graph, GraphType *type);
+const char *get_graph_name(Graph graph, uint64_t name_offset);
+int32_t *get_graph_column(Graph graph, GraphProperty *property); // Indexed by `instance - type->first_instance`
+
+// The edges of an instance, with the property each one comes from
+uint32_t *get_graph_edges(Graph graph, uint64_t instance, uint64_t *edges_count);
+uint32_t *get_graph_edge_properties(Graph graph, uint64_t instance);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,445 @@
+#include <string.h>
+
+#include "graph_file.h"
+#include "graph_writer.h"
+#include "memory.h"
+
+// Create graph writer
+GraphWriter *create_graph_writer(FILE *file, GraphFormat format)
+{
+    GraphWriter *writer = NEW(GraphWriter);
+    writer->file = file;
+    writer->format = format;
+    writer->buffer = (char *)malloc(GRAPH_WRITER_BUFFER_SIZE);
+    writer->buffer_count = 0;
+    return writer;
+}
+
+void free_graph_writer(GraphWriter *writer)
+{
+    flush_graph_writer(writer);
+    free(writer->buffer);
+    free(writer);
+}
+
+// Buffering
+void write_buffer_to_file(GraphWriter *writer)
+{
+    if (writer->buffer_count > 0 && fwrite(writer->buffer, 1, writer->buffer_count, writer->file) != writer->buffer_count)
+    {
+        fprintf(stderr, "Unable to write graph output\n");
+        exit(EXIT_FAILURE);
+    }
+
+    writer->buffer_count = 0;
+}
+
+void flush_graph_writer(GraphWriter *writer)
+{
+    write_buffer_to_file(writer);
+    fflush(writer->file);
+}
+
+void write_chars(GraphWriter *writer, const char *chars, size_t length)
+{
+    while (length > 0)
+    {
+        if (writer->buffer_count == GRAPH_WRITER_BUFFER_SIZE)
+            write_buffer_to_file(writer);
+
+        size_t room = GRAPH_WRITER_BUFFER_SIZE - writer->buffer_count;
+        size_t count = length < room ? length : room;
+        memcpy(writer->buffer + writer->buffer_count, chars, count);
+        writer->buffer_count += count;
+        chars += count;
+        length -= count;
+    }
+}
+
+void write_text(GraphWriter *writer, const char *text)
+{
+    write_chars(writer, text, strlen(text));
+}
+
+// Values
+void write_int(GraphWriter *writer, long long value)
+{
+    // Digits are written from the end of the scratch buffer backwards
+    char digits[24];
+    size_t start = sizeof(digits);
+    unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+
+    do
+    {
+        digits[--start] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+
+    if (value < 0)
+        digits[--start] = '-';
+
+    write_chars(writer, digits + start, sizeof(digits) - start);
+}
+
+void write_string(GraphWriter *writer, sub_string string)
+{
+    static const char hex_digits[] = "0123456789abcdef";
+
+    write_chars(writer, "\"", 1);
+
+    // Runs of characters that do not need escaping are written all at once
+    size_t run_start = 0;
+    for (size_t c = 0; c < string.len; c++)
+    {
+        unsigned char character = (unsigned char)string.str[c];
+        if (character >= 0x20 && character != '"' && character != '\\')
+            continue;
+
+        write_chars(writer, string.str + run_start, c - run_start);
+        run_start = c + 1;
+
+        char escaped[6] = {'\\', 'u', '0', '0', hex_digits[character >> 4], hex_digits[character & 0xF]};
+        if (character == '"' || character == '\\')
+        {
+            escaped[1] = (char)character;
+            write_chars(writer, escaped, 2);
+        }
+        else
+            write_chars(writer, escaped, sizeof(escaped));
+    }
+
+    write_chars(writer, string.str + run_start, string.len - run_start);
+    write_chars(writer, "\"", 1);
+}
+
+// Separators
+// NDJSON documents must stay on one line, so they leave out the line breaks and spaces that JSON documents have
+void write_line_break(GraphWriter *writer, const char *indent)
+{
+    if (writer->format == GRAPH_FORMAT__JSON)
+    {
+        write_chars(writer, "\n", 1);
+        write_text(writer, indent);
+    }
+}
+
+void write_separator(GraphWriter *writer, const char *separator)
+{
+    write_text(writer, separator);
+    if (writer->format == GRAPH_FORMAT__JSON)
+        write_chars(writer, " ", 1);
+}
+
+// Writing collapsed maps as JSON
+void write_property_value(GraphWriter *writer, Property *property, int value)
+{
+    if (property->type.primitive == TYPE_PRIMITIVE__BOOL)
+        write_text(writer, value != 0 ? "true" : "false");
+    else
+        write_int(writer, value); // A number, or the ID of the instance the property refers to
+}
+
+void write_node(GraphWriter *writer, Node *node)
+{
+    write_text(writer, "{\"name\":");
+    write_string(writer, node->name);
+    write_separator(writer, ",");
+    write_text(writer, "\"properties\":[");
+
+    for (size_t p = 0; p < node->properties_count; p++)
+    {
+        Property *property = node->properties + p;
+        if (p > 0)
+            write_separator(writer, ",");
+
+        write_text(writer, "{\"name\":");
+        write_string(writer, property->name);
+        write_separator(writer, ",");
+        write_text(writer, "\"type\":");
+
+        if (property->type.primitive == TYPE_PRIMITIVE__NODE)
+            write_string(writer, property->type.node->name);
+        else if (property->type.primitive == TYPE_PRIMITIVE__BOOL)
+            write_text(writer, "\"bool\"");
+        else
+            write_text(writer, "\"num\"");
+
+        write_text(writer, "}");
+    }
+
+    write_text(writer, "]}");
+}
+
+void write_collapsed_map_json(GraphWriter *writer, CollapsedMap *collapsed_map, size_t sample_index)
+{
+    write_text(writer, "{");
+    write_line_break(writer, "  ");
+    write_text(writer, "\"sample\":");
+    write_int(writer, (long long)sample_index);
+    write_text(writer, ",");
+    write_line_break(writer, "  ");
+
+    write_text(writer, "\"nodes\":[");
+    for (size_t t = 0; t < collapsed_map->types_count; t++)
+    {
+        if (t > 0)
+            write_text(writer, ",");
+        write_line_break(writer, "    ");
+        write_node(writer, collapsed_map->types[t].node);
+    }
+
+    write_line_break(writer, "  ");
+    write_text(writer, "],");
+    write_line_break(writer, "  ");
+
+    write_text(writer, "\"instances\":[");
+    for (size_t t = 0; t < collapsed_map->types_count; t++)
+    {
+        CollapsedType *type = collapsed_map->types + t;
+        Node *node = type->node;
+
+        for (size_t i = 0; i < type->instances_count; i++)
+        {
+            if (type->first_instance + i > 0)
+                write_text(writer, ",");
+            write_line_break(writer, "    ");
+
+            write_text(writer, "{\"id\":");
+            write_int(writer, (long long)(type->first_instance + i));
+            write_separator(writer, ",");
+            write_text(writer, "\"node\":");
+            write_string(writer, node->name);
+            write_separator(writer, ",");
+            write_text(writer, "\"properties\":{");
+
+            for (size_t p = 0; p < node->properties_count; p++)
+            {
+                Property *property = node->properties + p;
+                if (p > 0)
+                    write_separator(writer, ",");
+
+                write_string(writer, property->name);
+                write_text(writer, ":");
+                write_property_value(writer, property, type->columns[p][i]);
+            }
+
+            write_text(writer, "}}");
+        }
+    }
+
+    write_line_break(writer, "  ");
+    write_text(writer, "]");
+    write_line_break(writer, "");
+    write_text(writer, "}\n");
+}
+
+// Writing collapsed maps as graph files
+#define ALIGN_8(size) (((size) + 7) & ~(uint64_t)7)
+
+void write_zeroes(GraphWriter *writer, size_t count)
+{
+    static const char zeroes[8] = {0};
+    write_chars(writer, zeroes, count);
+}
+
+// NOTE: Every section's size is known before anything is written, so the whole graph is laid out first and then
+// written front to back, without seeking back to fill in offsets
+void write_collapsed_map_csr(GraphWriter *writer, CollapsedMap *collapsed_map, size_t sample_index)
+{
+    // Types
+    size_t types_count = collapsed_map->types_count;
+    GraphType *types = (GraphType *)malloc(sizeof(GraphType) * types_count);
+    for (size_t t = 0; t < types_count; t++)
+    {
+        Node *node = collapsed_map->types[t].node;
+        types[t].name_length = (uint32_t)node->name.len;
+        types[t].properties_count = (uint32_t)node->properties_count;
+        types[t].first_instance = collapsed_map->types[t].first_instance;
+        types[t].instances_count = collapsed_map->types[t].instances_count;
+    }
+
+    // Properties
+    GraphProperty *properties;
+    size_t properties_count;
+    size_t properties_capacity;
+    INIT_ARRAY(properties);
+
+    uint64_t edges_count = 0;
+    for (size_t t = 0; t < types_count; t++)
+    {
+        Node *node = collapsed_map->types[t].node;
+        uint32_t edge_index = 0;
+
+        for (size_t p = 0; p < node->properties_count; p++)
+        {
+            Property *node_property = node->properties + p;
+            GraphProperty *property = EXTEND_ARRAY(properties, GraphProperty);
+            property->name_length = (uint32_t)node_property->name.len;
+            property->target_type = 0;
+            property->edge_index = 0;
+            property->column_offset = 0;
+
+            if (node_property->type.primitive == TYPE_PRIMITIVE__NODE)
+            {
+                property->type = GRAPH_PROPERTY_TYPE__NODE;
+                property->edge_index = edge_index++;
+                while (property->target_type < types_count && collapsed_map->types[property->target_type].node != node_property->type.node)
+                    property->target_type++;
+            }
+            else if (node_property->type.primitive == TYPE_PRIMITIVE__BOOL)
+                property->type = GRAPH_PROPERTY_TYPE__BOOL;
+            else
+                property->type = GRAPH_PROPERTY_TYPE__NUMBER;
+        }
+
+        edges_count += edge_index * types[t].instances_count;
+    }
+
+    // Layout
+    GraphHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, GRAPH_FILE_MAGIC, sizeof(header.magic));
+    header.version = GRAPH_FILE_VERSION;
+    header.types_count = (uint32_t)types_count;
+    header.sample = sample_index;
+    header.instances_count = collapsed_map->instances_count;
+    header.edges_count = edges_count;
+
+    uint64_t offset = ALIGN_8(sizeof(GraphHeader));
+    header.types_offset = offset;
+    offset += sizeof(GraphType) * types_count;
+
+    for (size_t t = 0, first_property = 0; t < types_count; first_property += types[t].properties_count, t++)
+        types[t].properties_offset = offset + sizeof(GraphProperty) * first_property;
+    offset += sizeof(GraphProperty) * properties_count;
+
+    for (size_t t = 0, property_index = 0; t < types_count; t++)
+    {
+        for (uint32_t p = 0; p < types[t].properties_count; p++, property_index++)
+        {
+            GraphProperty *property = properties + property_index;
+            if (property->type == GRAPH_PROPERTY_TYPE__NODE)
+                continue;
+
+            property->column_offset = offset;
+            offset += ALIGN_8(sizeof(int32_t) * types[t].instances_count);
+        }
+    }
+
+    header.edge_offsets_offset = offset;
+    offset += sizeof(uint64_t) * (collapsed_map->instances_count + 1);
+    header.edge_targets_offset = offset;
+    offset += ALIGN_8(sizeof(uint32_t) * edges_count);
+    header.edge_properties_offset = offset;
+    offset += ALIGN_8(sizeof(uint32_t) * edges_count);
+
+    // Each type's name is followed by the names of its properties
+    uint64_t names_size = 0;
+    for (size_t t = 0, property_index = 0; t < types_count; t++)
+    {
+        types[t].name_offset = offset + names_size;
+        names_size += types[t].name_length;
+
+        for (uint32_t p = 0; p < types[t].properties_count; p++, property_index++)
+        {
+            properties[property_index].name_offset = offset + names_size;
+            names_size += properties[property_index].name_length;
+        }
+    }
+    offset += ALIGN_8(names_size);
+    header.size = offset;
+
+    // Header & tables
+    write_chars(writer, (const char *)&header, sizeof(header));
+    write_zeroes(writer, ALIGN_8(sizeof(GraphHeader)) - sizeof(GraphHeader));
+    write_chars(writer, (const char *)types, sizeof(GraphType) * types_count);
+    write_chars(writer, (const char *)properties, sizeof(GraphProperty) * properties_count);
+
+    // Columns
+    // NOTE: Collapsed maps already store each property as a column of `int`s, so columns are written whole
+    for (size_t t = 0, property_index = 0; t < types_count; t++)
+    {
+        CollapsedType *type = collapsed_map->types + t;
+        for (size_t p = 0; p < type->node->properties_count; p++, property_index++)
+        {
+            if (properties[property_index].type == GRAPH_PROPERTY_TYPE__NODE)
+                continue;
+
+            write_chars(writer, (const char *)type->columns[p], sizeof(int32_t) * type->instances_count);
+            write_zeroes(writer, ALIGN_8(sizeof(int32_t) * type->instances_count) - sizeof(int32_t) * type->instances_count);
+        }
+    }
+
+    // Edges
+    // Every instance of a type has the same number of edges, one for each of the type's node properties
+    uint64_t edge_offset = 0;
+    write_chars(writer, (const char *)&edge_offset, sizeof(edge_offset));
+    for (size_t t = 0, property_index = 0; t < types_count; t++)
+    {
+        uint64_t instance_edges_count = 0;
+        for (uint32_t p = 0; p < types[t].properties_count; p++, property_index++)
+        {
+            if (properties[property_index].type == GRAPH_PROPERTY_TYPE__NODE)
+                instance_edges_count++;
+        }
+
+        for (uint64_t i = 0; i < types[t].instances_count; i++)
+        {
+            edge_offset += instance_edges_count;
+            write_chars(writer, (const char *)&edge_offset, sizeof(edge_offset));
+        }
+    }
+
+    for (size_t t = 0; t < types_count; t++)
+    {
+        CollapsedType *type = collapsed_map->types + t;
+        for (size_t i = 0; i < type->instances_count; i++)
+        {
+            for (size_t p = 0; p < type->node->properties_count; p++)
+            {
+                if (type->node->properties[p].type.primitive != TYPE_PRIMITIVE__NODE)
+                    continue;
+
+                uint32_t target = (uint32_t)type->columns[p][i];
+                write_chars(writer, (const char *)&target, sizeof(target));
+            }
+        }
+    }
+    write_zeroes(writer, ALIGN_8(sizeof(uint32_t) * edges_count) - sizeof(uint32_t) * edges_count);
+
+    for (size_t t = 0; t < types_count; t++)
+    {
+        Node *node = collapsed_map->types[t].node;
+        for (size_t i = 0; i < collapsed_map->types[t].instances_count; i++)
+        {
+            for (uint32_t p = 0; p < node->properties_count; p++)
+            {
+                if (node->properties[p].type.primitive == TYPE_PRIMITIVE__NODE)
+                    write_chars(writer, (const char *)&p, sizeof(p));
+            }
+        }
+    }
+    write_zeroes(writer, ALIGN_8(sizeof(uint32_t) * edges_count) - sizeof(uint32_t) * edges_count);
+
+    // Names
+    for (size_t t = 0; t < types_count; t++)
+    {
+        Node *node = collapsed_map->types[t].node;
+        write_chars(writer, node->name.str, node->name.len);
+        for (size_t p = 0; p < node->properties_count; p++)
+            write_chars(writer, node->properties[p].name.str, node->properties[p].name.len);
+    }
+    write_zeroes(writer, ALIGN_8(names_size) - names_size);
+
+    free(types);
+    free(properties);
+}
+
+// Writing collapsed maps
+void write_collapsed_map(GraphWriter *writer, CollapsedMap *collapsed_map, size_t sample_index)
+{
+    if (writer->format == GRAPH_FORMAT__CSR)
+        write_collapsed_map_csr(writer, collapsed_map, sample_index);
+    else
+        write_collapsed_map_json(writer, collapsed_map, sample_index);
+}
@@ -0,0 +1,54 @@
+#ifndef GRAPH_WRITER_H
+#define GRAPH_WRITER_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "collapsed_map.h"
+
+// Graph writer
+// Writes collapsed maps as JSON, for other programs to read. Each collapsed map is one document, which lists every
+// node (with the type of each of its properties) followed by every instance (with the value of each of its
+// properties). Values are typed: `bool` properties are written as `true` or `false`, `num` properties as numbers,
+// and properties that refer to a node as the ID of the instance they refer to (which is its index in the map).
+//
+// e.g. {"sample":0,"nodes":[{"name":"Person","properties":[{"name":"buddy","type":"Person"}]}],
+//       "instances":[{"id":0,"node":"Person","properties":{"buddy":1}},{"id":1,"node":"Person","properties":{"buddy":0}}]}
+//
+// Collapsed maps can also be written as graph files (see "graph_file.h"), which are far quicker to load.
+//
+// Several documents can be written one after another (e.g. one for each sample of a batch). Output is built up in a
+// large buffer, which is only written to the file when it fills up or is flushed.
+
+// GraphFormat
+typedef enum
+{
+    GRAPH_FORMAT__INVALID,
+
+    GRAPH_FORMAT__JSON,   // Each document is spread over several lines (one per node and one per instance)
+    GRAPH_FORMAT__NDJSON, // Each document is on a single line
+    GRAPH_FORMAT__CSR,    // Each document is a binary graph
+} GraphFormat;
+
+#define GRAPH_WRITER_BUFFER_SIZE (256 * 1024)
+
+// GraphWriter
+typedef struct
+{
+    FILE *file;
+    GraphFormat format;
+    char *buffer;
+    size_t buffer_count;
+} GraphWriter;
+
+GraphWriter *create_graph_writer(FILE *file, GraphFormat format);
+void free_graph_writer(GraphWriter *writer); // Flushes the writer, but does not close its file
+
+// Writing collapsed maps
+void write_collapsed_map(GraphWriter *writer, CollapsedMap *collapsed_map, size_t sample_index);
+
+// Write everything that is buffered to the file (and flush the file), so that readers see every document written so far
+void flush_graph_writer(GraphWriter *writer);
+
+#endif
\ No newline at end of file
@@ -3,25 +3,39 @@
 #include <string.h>
 #include <time.h>
 
+#include "cache.h"
 #include "constraints.h"
 #include "collapse.h"
 #include "collapsed_map.h"
+#include "graph_writer.h"
 #include "parse.h"
+#include "portfolio.h"
 #include "resolve.h"
 #include "program.h"
 #include "quantum_map.h"
+#include "random.h"
 #include "solve.h"
 #include "token.h"
 #include "tokenise.h"
+#include "work_stealing.h"
 
-#define PRINT_HEADING(text) printf("\x1b[32m" text "\n\x1b[0m")
+// NOTE: Headings are left out when the graph is written to stdout (which no other output can be), so that stdout only holds JSON
+bool print_headings = true;
+
+#define PRINT_HEADING(text)                              \
+    do                                                   \
+    {                                                    \
+        if (print_headings)                              \
+            printf("\x1b[32m" text "\n\x1b[0m");          \
+    } while (0)
+#define USAGE "Usage: %s <file_path> [<Node>:<instances> ...] [-all] [-t] [-p] [-r] [-q] [-c] [-s] [-f] [-stats] [-order lex|mrv|domwdeg] [-threads <count>] [-split] [-count <samples>] [-cache <cache_path>] [-json|-ndjson <graph_path>|-] [-csr <graph_path>]\n"
 
 int main(int argc, char const *argv[])
 {
     // Validate arguments
     if (argc < 2)
     {
-        fprintf(stderr, "Usage: %s <file_path> [-all] [-t] [-p] [-r] [-q] [-c] [-s] [-f]\n", argv[0]);
+        fprintf(stderr, USAGE, argv[0]);
         return EXIT_FAILURE;
     }
 
@@ -33,6 +47,22 @@ int main(int argc, char const *argv[])
     bool flag_output_constraints = false;   // -c
     bool flag_output_solved_map = false;    // -s
     bool flag_output_collapsed_map = false; // -f
+    bool flag_output_solve_stats = false;   // -stats
+
+    // Instance counts (e.g. `Person:32`), which are matched to nodes once the program has been resolved
+    const char **instance_count_args = (const char **)malloc(sizeof(const char *) * argc);
+    size_t instance_count_args_count = 0;
+
+    // Parse options
+    SolveOptions solve_options;
+    solve_options.variable_order = VARIABLE_ORDER__LEXICAL; // -order
+    solve_options.cancel = NULL;
+    size_t threads_count = 1; // -threads
+    bool flag_split_search = false; // -split
+    size_t samples_count = 1;       // -count
+    const char *cache_path = NULL;  // -cache
+    GraphFormat graph_format = GRAPH_FORMAT__INVALID; // -json, -ndjson, -csr
+    const char *graph_path = NULL;                    // "-" for stdout
 
     for (int i = 2; i < argc; i++)
     {
@@ -45,6 +75,7 @@ int main(int argc, char const *argv[])
             flag_output_constraints = true;
             flag_output_solved_map = true;
             flag_output_collapsed_map = true;
+            flag_output_solve_stats = true;
         }
         else if (strcmp(argv[i], "-t") == 0)
             flag_output_tokens = true;
@@ -60,15 +91,124 @@ int main(int argc, char const *argv[])
             flag_output_solved_map = true;
         else if (strcmp(argv[i], "-f") == 0)
             flag_output_collapsed_map = true;
+        else if (strcmp(argv[i], "-stats") == 0)
+            flag_output_solve_stats = true;
+        else if (strcmp(argv[i], "-order") == 0 && i + 1 < argc)
+        {
+            solve_options.variable_order = variable_order_from_string(argv[++i]);
+            if (solve_options.variable_order == VARIABLE_ORDER__INVALID)
+            {
+                fprintf(stderr, "Unknown variable order '%s'\n", argv[i]);
+                fprintf(stderr, USAGE, argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+        else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+        {
+            char *end = NULL;
+            long count = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || count < 1)
+            {
+                fprintf(stderr, "Invalid number of threads '%s'\n", argv[i]);
+                fprintf(stderr, USAGE, argv[0]);
+                return EXIT_FAILURE;
+            }
+
+            threads_count = (size_t)count;
+        }
+        else if (strcmp(argv[i], "-split") == 0)
+            flag_split_search = true;
+        else if (strcmp(argv[i], "-count") == 0 && i + 1 < argc)
+        {
+            char *end = NULL;
+            long count = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || count < 1)
+            {
+                fprintf(stderr, "Invalid number of samples '%s'\n", argv[i]);
+                fprintf(stderr, USAGE, argv[0]);
+                return EXIT_FAILURE;
+            }
+
+            samples_count = (size_t)count;
+        }
+        else if (strcmp(argv[i], "-cache") == 0 && i + 1 < argc)
+            cache_path = argv[++i];
+        else if (strcmp(argv[i], "-json") == 0 && i + 1 < argc)
+        {
+            graph_format = GRAPH_FORMAT__JSON;
+            graph_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "-ndjson") == 0 && i + 1 < argc)
+        {
+            graph_format = GRAPH_FORMAT__NDJSON;
+            graph_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "-csr") == 0 && i + 1 < argc)
+        {
+            graph_format = GRAPH_FORMAT__CSR;
+            graph_path = argv[++i];
+        }
+        else if (argv[i][0] != '-' && strchr(argv[i], ':') != NULL)
+            instance_count_args[instance_count_args_count++] = argv[i];
         else
         {
-            fprintf(stderr, "Usage: %s <file_path> [-all] [-t] [-p] [-r] [-q] [-c] [-s] [-f]\n", argv[0]);
+            fprintf(stderr, USAGE, argv[0]);
             return EXIT_FAILURE;
         }
     }
 
+    // NOTE: Each sample is solved on one thread, as the point of a batch is to reuse one search for every sample
+    if (samples_count > 1 && threads_count > 1)
+    {
+        fprintf(stderr, "-count can not be combined with -threads\n");
+        return EXIT_FAILURE;
+    }
+
+    // The search is only split between threads, so with one thread `-split` would be ignored
+    if (flag_split_search && threads_count <= 1)
+    {
+        fprintf(stderr, "-split can only be used with -threads (and more than one thread)\n");
+        return EXIT_FAILURE;
+    }
+
+    // Open graph output
+    // Every sample is written to the same file, as its own document
+    GraphWriter *graph_writer = NULL;
+    if (graph_path != NULL)
+    {
+        FILE *graph_file = stdout;
+        if (strcmp(graph_path, "-") == 0 && graph_format == GRAPH_FORMAT__CSR)
+        {
+            fprintf(stderr, "-csr can not be written to stdout\n");
+            return EXIT_FAILURE;
+        }
+        else if (strcmp(graph_path, "-") == 0)
+        {
+            // Every other output is plain text on stdout, which would be mixed in with the JSON
+            if (flag_output_tokens || flag_output_parse || flag_output_resolve || flag_output_quantum_map ||
+                flag_output_constraints || flag_output_solved_map || flag_output_collapsed_map || flag_output_solve_stats)
+            {
+                fprintf(stderr, "-json - and -ndjson - can not be combined with -all, -t, -p, -r, -q, -c, -s, -f or -stats\n");
+                return EXIT_FAILURE;
+            }
+
+            print_headings = false;
+        }
+        else
+        {
+            graph_file = fopen(graph_path, "wb");
+            if (graph_file == NULL)
+            {
+                fprintf(stderr, "Unable to open graph file %s\n", graph_path);
+                return EXIT_FAILURE;
+            }
+        }
+
+        graph_writer = create_graph_writer(graph_file, graph_format);
+    }
+
     // Initialise RNG
-    srand(time(NULL));
+    solve_options.seed = (uint64_t)time(NULL);
 
     // Read source file
     const char *source_path = argv[1];
@@ -101,75 +241,214 @@ int main(int argc, char const *argv[])
         fclose(source_file);
     }
 
-    // Tokenise
-    PRINT_HEADING("TOKENISING");
-    TokenArray source_tokens = tokenise(source_text);
+    // Load compiled cache
+    // Everything up to solving depends only on the source text and instance counts, so it can be loaded from a cache
+    // written by an earlier run (unless the output of a stage that would be skipped was asked for)
+    QuantumMap *quantum_map = NULL;
+    Constraints constraints;
+    CompiledCache cache;
+    uint64_t key = cache_key(source_text, instance_count_args, instance_count_args_count);
+    bool skip_to_solve = cache_path != NULL && !flag_output_tokens && !flag_output_parse && !flag_output_resolve;
+    bool cache_loaded = skip_to_solve && open_compiled_cache(cache_path, key, &cache);
 
-    if (flag_output_tokens)
+    if (cache_loaded)
     {
-        print_tokens(source_tokens);
-        printf("\n");
-    }
+        PRINT_HEADING("LOADING COMPILED CACHE");
+        quantum_map = cache.quantum_map;
+        constraints = *cache.constraints;
 
-    // Parse
-    PRINT_HEADING("PARSING");
-    Program *program = parse(source_tokens);
+        if (flag_output_quantum_map)
+        {
+            printf("%d node instances, resulting in %d variables\n", quantum_map->instances_count, quantum_map->variables_count);
+            print_quantum_map(quantum_map);
+            printf("\n");
+        }
 
-    if (flag_output_parse)
-    {
-        print_program(program);
-        printf("\n");
+        if (flag_output_constraints)
+        {
+            print_constraints(constraints);
+            printf("\n");
+        }
     }
+    else
+    {
+        // Tokenise
+        PRINT_HEADING("TOKENISING");
+        TokenArray source_tokens = tokenise(source_text);
 
-    // Resolve
-    PRINT_HEADING("RESOLVING");
-    resolve(program);
+        if (flag_output_tokens)
+        {
+            print_tokens(source_tokens);
+            printf("\n");
+        }
 
-    if (flag_output_resolve)
-    {
-        print_program(program);
-        printf("\n");
-    }
+        // Parse
+        PRINT_HEADING("PARSING");
+        Program *program = parse(source_tokens);
 
-    // Create quantum-map
-    PRINT_HEADING("CREATING QUANTUM MAP");
-    QuantumMap *quantum_map = create_quantum_map(program);
+        if (flag_output_parse)
+        {
+            print_program(program);
+            printf("\n");
+        }
 
-    if (flag_output_quantum_map)
-    {
-        printf("%d node instances, resulting in %d variables\n", quantum_map->instances_count, quantum_map->variables_count);
-        print_quantum_map(quantum_map);
-        printf("\n");
-    }
+        // Resolve
+        PRINT_HEADING("RESOLVING");
+        resolve(program);
+
+        if (flag_output_resolve)
+        {
+            print_program(program);
+            printf("\n");
+        }
 
-    // Create constraints
-    PRINT_HEADING("CREATING CONSTRAINTS");
-    Constraints constraints = create_constraints(program, quantum_map);
+        // Match instance counts to nodes
+        size_t *node_instances_count = (size_t *)malloc(sizeof(size_t) * (program->nodes_count + 1));
+        for (size_t n = 0; n < program->nodes_count; n++)
+            node_instances_count[n] = DEFAULT_INSTANCES_PER_NODE;
 
-    if (flag_output_constraints)
-    {
-        print_constraints(constraints);
-        printf("\n");
+        for (size_t i = 0; i < instance_count_args_count; i++)
+        {
+            const char *arg = instance_count_args[i];
+            const char *colon = strchr(arg, ':');
+            sub_string node_name = (sub_string){.str = arg, .len = (size_t)(colon - arg)};
+
+            char *end = NULL;
+            long count = strtol(colon + 1, &end, 10);
+            if (colon[1] == '\0' || *end != '\0' || count < 0)
+            {
+                fprintf(stderr, "Invalid number of instances in '%s'\n", arg);
+                return EXIT_FAILURE;
+            }
+
+            size_t n = 0;
+            while (n < program->nodes_count && !substrings_match(program->nodes[n].name, node_name))
+                n++;
+
+            if (n == program->nodes_count)
+            {
+                fprintf(stderr, "There is no node named '%.*s'\n", node_name.len, node_name.str);
+                return EXIT_FAILURE;
+            }
+
+            node_instances_count[n] = (size_t)count;
+        }
+
+        // Create quantum-map
+        PRINT_HEADING("CREATING QUANTUM MAP");
+        quantum_map = create_quantum_map(program, node_instances_count);
+
+        if (flag_output_quantum_map)
+        {
+            printf("%d node instances, resulting in %d variables\n", quantum_map->instances_count, quantum_map->variables_count);
+            print_quantum_map(quantum_map);
+            printf("\n");
+        }
+
+        // Create constraints
+        PRINT_HEADING("CREATING CONSTRAINTS");
+        constraints = create_constraints(program, quantum_map);
+
+        if (flag_output_constraints)
+        {
+            print_constraints(constraints);
+            printf("\n");
+        }
+
+        if (cache_path != NULL && !write_compiled_cache(cache_path, key, quantum_map, &constraints))
+            fprintf(stderr, "Unable to write cache file %s\n", cache_path);
     }
 
     // Solve quantum-map
-    PRINT_HEADING("SOLVING QUANTUM MAP");
-    solve(quantum_map, constraints);
+    // With -count, every sample after the first is solved from a snapshot of the first's domains at the root (so the
+    // front end and constraints are only built once), and each sample is printed as soon as it is solved
+    SolveBatch *batch = samples_count > 1 ? create_solve_batch(quantum_map, constraints, solve_options) : NULL;
 
-    if (flag_output_solved_map)
+    for (size_t s = 0; s < samples_count; s++)
     {
-        print_quantum_map(quantum_map);
-        printf("\n");
-    }
+        if (samples_count > 1 && print_headings)
+            printf("\x1b[32mSAMPLE %zu\n\x1b[0m", s);
 
-    // Collapse quantum-map to regular map
-    PRINT_HEADING("COLLAPSING MAP");
-    CollapsedMap *collapsed_map = collapse(quantum_map);
+        PRINT_HEADING("SOLVING QUANTUM MAP");
+        SolveStats solve_stats;
+        VariableOrder solve_order = solve_options.variable_order;
+        size_t winner_index = 0;
+        size_t tasks_count = 0;
+        size_t tasks_stolen = 0;
+        if (batch != NULL)
+            solve_stats = solve_batch_sample(batch, s == 0 ? solve_options.seed : derive_seed(solve_options.seed, s));
+        else if (threads_count > 1 && flag_split_search)
+        {
+            SplitStats split_stats = solve_split(quantum_map, constraints, solve_options, threads_count);
+            solve_stats = split_stats.solve_stats;
+            winner_index = split_stats.winner_index;
+            tasks_count = split_stats.tasks_count;
+            tasks_stolen = split_stats.tasks_stolen;
+        }
+        else if (threads_count > 1)
+        {
+            PortfolioStats portfolio_stats = solve_portfolio(quantum_map, constraints, solve_options, threads_count);
+            solve_stats = portfolio_stats.solve_stats;
+            solve_order = portfolio_stats.winner_order;
+            winner_index = portfolio_stats.winner_index;
+        }
+        else
+            solve_stats = solve(quantum_map, constraints, solve_options);
+
+        if (solve_stats.status != SOLVE_STATUS__SOLVED)
+        {
+            fprintf(stderr, "Could not find a valid solution");
+            return EXIT_FAILURE;
+        }
+
+        if (flag_output_solve_stats)
+        {
+            if (threads_count > 1)
+                printf("threads:         %zu (solved by #%zu)\n", threads_count, winner_index);
+            if (threads_count > 1 && flag_split_search)
+                printf("tasks:           %zu (%zu stolen)\n", tasks_count, tasks_stolen);
+            printf("variable order:  %s\n", variable_order_string(solve_order));
+            print_solve_stats(solve_stats);
+            printf("\n");
+        }
+
+        if (flag_output_solved_map)
+        {
+            print_quantum_map(quantum_map);
+            printf("\n");
+        }
+
+        // Collapse quantum-map to regular map
+        PRINT_HEADING("COLLAPSING MAP");
+        CollapsedMap *collapsed_map = collapse(quantum_map);
+
+        if (flag_output_collapsed_map)
+        {
+            print_collapsed_map(collapsed_map);
+            printf("\n");
+        }
+
+        // Each document is flushed as soon as it is written, so that readers can start on a sample while the next is solved
+        if (graph_writer != NULL)
+        {
+            write_collapsed_map(graph_writer, collapsed_map, s);
+            flush_graph_writer(graph_writer);
+        }
+
+        free_collapsed_map(collapsed_map);
+        fflush(stdout);
+    }
 
-    if (flag_output_collapsed_map)
+    if (batch != NULL)
+        free_solve_batch(batch);
+    if (cache_loaded)
+        close_compiled_cache(&cache);
+    if (graph_writer != NULL)
     {
-        print_collapsed_map(collapsed_map);
-        printf("\n");
+        FILE *graph_file = graph_writer->file;
+        free_graph_writer(graph_writer);
+        if (graph_file != stdout)
+            fclose(graph_file);
     }
 
     PRINT_HEADING("COMPILER COMPLETE");
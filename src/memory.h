@@ -1,17 +1,55 @@
 #ifndef MEMORY_H
 #define MEMORY_H
 
+#include <stdio.h>
+#include <stdlib.h>
+
 #define NEW(type) (type *)malloc(sizeof(type));
 
+// Allocate `count` elements of `type`, aligned to `alignment` bytes (which must be a power of two)
+#ifdef _WIN32
+#define ALIGNED_ALLOC(type, alignment, count) (type *)_aligned_malloc(sizeof(type) * (count), alignment)
+#define ALIGNED_FREE(pointer) _aligned_free(pointer)
+#else
+#define ALIGNED_ALLOC(type, alignment, count) (type *)aligned_alloc(alignment, ((sizeof(type) * (count) + (alignment)-1) / (alignment)) * (alignment))
+#define ALIGNED_FREE(pointer) free(pointer)
+#endif
+
+// Growable arrays
+// An array `array` is stored alongside `array##_count` (the number of elements in use) and `array##_capacity`
+// (the number of elements allocated). The capacity at least doubles whenever it runs out, so appending an element
+// is amortised constant time.
 #define INIT_ARRAY(array) \
     array = NULL;         \
-    array##_count = 0;
-
-#define EXTEND_ARRAY(array, type)                                               \
-    (                                                                           \
-        (array = (type *)((array##_count++ == 0)                                \
-                              ? malloc(sizeof(type))                            \
-                              : realloc(array, sizeof(type) * array##_count))), \
-        (array + array##_count - 1))
+    array##_count = 0;    \
+    array##_capacity = 0;
+
+// Make room for at least `extra` more elements (e.g. when the final size of the array is known up front)
+#define RESERVE_ARRAY(array, type, extra) \
+    (array = (type *)grow_array(array, sizeof(type), &array##_capacity, array##_count + (extra)))
+
+// Append an element, returning a pointer to it
+#define EXTEND_ARRAY(array, type) \
+    (RESERVE_ARRAY(array, type, 1), array + array##_count++)
+
+static inline void *grow_array(void *array, size_t element_size, size_t *capacity, size_t required)
+{
+    if (required <= *capacity)
+        return array;
+
+    size_t new_capacity = *capacity < 4 ? 4 : *capacity * 2;
+    while (new_capacity < required)
+        new_capacity *= 2;
+
+    array = realloc(array, element_size * new_capacity);
+    if (array == NULL)
+    {
+        fprintf(stderr, "Unable to allocate memory for %zu array elements\n", new_capacity);
+        exit(EXIT_FAILURE);
+    }
+
+    *capacity = new_capacity;
+    return array;
+}
 
 #endif
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include <stdio.h>
+
+#include "memory.h"
+#include "nogood.h"
+
+// Create nogood store
+NogoodStore *create_nogood_store(size_t variables_count)
+{
+    NogoodStore *store = NEW(NogoodStore);
+    store->nogoods_count = 0;
+    store->next_slot = 0;
+    store->next_id = 1;
+
+    for (size_t i = 0; i < NOGOODS_CAPACITY; i++)
+    {
+        store->nogoods[i].literals_count = 0;
+        store->nogoods[i].id = 0;
+    }
+
+    store->watching = (size_t **)calloc(variables_count + 1, sizeof(size_t *));
+    store->watching_count = (size_t *)calloc(variables_count + 1, sizeof(size_t));
+    store->watching_capacity = (size_t *)calloc(variables_count + 1, sizeof(size_t));
+
+    return store;
+}
+
+// Watching variables
+void watch_variable(NogoodStore *store, size_t var_index, size_t slot)
+{
+    if (store->watching_count[var_index] == store->watching_capacity[var_index])
+    {
+        size_t capacity = store->watching_capacity[var_index] == 0 ? 4 : store->watching_capacity[var_index] * 2;
+        store->watching[var_index] = (size_t *)realloc(store->watching[var_index], sizeof(size_t) * capacity);
+        store->watching_capacity[var_index] = capacity;
+    }
+
+    store->watching[var_index][store->watching_count[var_index]++] = slot;
+}
+
+void unwatch_variable(NogoodStore *store, size_t var_index, size_t slot)
+{
+    size_t *watching = store->watching[var_index];
+    size_t count = store->watching_count[var_index];
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (watching[i] == slot)
+        {
+            watching[i] = watching[count - 1];
+            store->watching_count[var_index]--;
+            return;
+        }
+    }
+}
+
+// Learning nogoods
+size_t learn_nogood(NogoodStore *store, NogoodLiteral *literals, size_t literals_count)
+{
+    if (literals_count == 0 || literals_count > MAX_NOGOOD_LITERALS)
+        return NOGOODS_CAPACITY;
+
+    // Forget whichever nogood is currently in the slot
+    size_t slot = store->next_slot;
+    Nogood *nogood = store->nogoods + slot;
+
+    if (nogood->id != 0)
+    {
+        for (size_t i = 0; i < nogood->literals_count; i++)
+            unwatch_variable(store, nogood->literals[i].var_index, slot);
+        store->nogoods_count--;
+    }
+
+    // Store the new nogood
+    nogood->id = store->next_id++;
+    nogood->literals_count = literals_count;
+    for (size_t i = 0; i < literals_count; i++)
+    {
+        nogood->literals[i] = literals[i];
+        watch_variable(store, literals[i].var_index, slot);
+    }
+
+    store->nogoods_count++;
+    store->next_slot = (slot + 1) % NOGOODS_CAPACITY;
+
+    return slot;
+}
+
+// Forgetting nogoods
+// NOTE: IDs keep counting up, so nothing that referred to a forgotten nogood can mistake a new one for it
+void forget_nogoods(NogoodStore *store)
+{
+    for (size_t slot = 0; slot < NOGOODS_CAPACITY; slot++)
+    {
+        Nogood *nogood = store->nogoods + slot;
+        for (size_t i = 0; i < nogood->literals_count; i++)
+            store->watching_count[nogood->literals[i].var_index] = 0;
+
+        nogood->literals_count = 0;
+        nogood->id = 0;
+    }
+
+    store->nogoods_count = 0;
+    store->next_slot = 0;
+}
+
+// Looking up nogoods
+// Nogood slots are reused once the store is full, so anything that refers back to a nogood
+// must check that the nogood it refers to has not since been forgotten.
+bool nogood_is_current(NogoodStore *store, size_t slot, size_t id)
+{
+    return slot < NOGOODS_CAPACITY && store->nogoods[slot].id == id;
+}
@@ -0,0 +1,57 @@
+#ifndef NOGOOD_H
+#define NOGOOD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Nogoods
+// A nogood is a set of collapses (variable = value) that conflict analysis has proven can never all hold
+// at once. They are learned during search, and checked during propagation so that the same dead end
+// is not explored again. The store is bounded: once it is full, the oldest nogood is forgotten.
+
+#define MAX_NOGOOD_LITERALS 8
+#define NOGOODS_CAPACITY 1024
+
+// NogoodLiteral
+typedef struct
+{
+    size_t var_index;
+    int value;
+} NogoodLiteral;
+
+// Nogood
+typedef struct
+{
+    NogoodLiteral literals[MAX_NOGOOD_LITERALS];
+    size_t literals_count;
+    size_t id; // Unique to each nogood that is learned, 0 if the slot is empty
+} Nogood;
+
+// NogoodStore
+typedef struct
+{
+    Nogood nogoods[NOGOODS_CAPACITY];
+    size_t nogoods_count;
+    size_t next_slot;
+    size_t next_id;
+
+    // Slots of the nogoods that contain each variable
+    size_t **watching;
+    size_t *watching_count;
+    size_t *watching_capacity;
+} NogoodStore;
+
+NogoodStore *create_nogood_store(size_t variables_count);
+
+// Learning nogoods
+// Returns the slot the nogood was stored in, or `NOGOODS_CAPACITY` if it was not stored
+size_t learn_nogood(NogoodStore *store, NogoodLiteral *literals, size_t literals_count);
+
+// Forget every nogood in the store
+void forget_nogoods(NogoodStore *store);
+
+// Looking up nogoods
+bool nogood_is_current(NogoodStore *store, size_t slot, size_t id);
+
+#endif
\ No newline at end of file
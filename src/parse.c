@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "arena.h"
 #include "memory.h"
 #include "parse.h"
 
@@ -47,6 +48,7 @@ Token eat(Parser *parser, TokenKind expectation)
 
 // Parse methods
 void parse_program(Parser *parser);
+int parse_integer(Parser *parser);
 void parse_node_declaration(Parser *parser);
 void parse_rule(Parser *parser);
 Expression *parse_expression(Parser *parser);
@@ -57,6 +59,7 @@ Program *parse(TokenArray tokens)
     Program *program = NEW(Program);
     INIT_ARRAY(program->nodes);
     INIT_ARRAY(program->rules);
+    program->arena = create_arena(ARENA_BLOCK_SIZE);
 
     Parser parser;
     parser.program = program;
@@ -84,6 +87,26 @@ void parse_program(Parser *parser)
     eat(parser, END_OF_FILE);
 }
 
+// Parse integer
+// A number, optionally preceded by a minus sign
+int parse_integer(Parser *parser)
+{
+    bool negative = false;
+    if (peek(parser, MINUS))
+    {
+        eat(parser, MINUS);
+        negative = true;
+    }
+
+    Token t = eat(parser, NUMBER);
+
+    int num = 0;
+    for (size_t i = 0; i < t.str.len; i++)
+        num = num * 10 + ((int)(t.str.str[i]) - 48);
+
+    return negative ? -num : num;
+}
+
 // Parse node declaration
 void parse_node_declaration(Parser *parser)
 {
@@ -113,6 +136,19 @@ void parse_node_declaration(Parser *parser)
 
         Token property_kind = eat(parser, NAME);
         property->type_name = property_kind.str;
+
+        // Range, e.g. `(0..1000)`
+        property->has_range = false;
+        if (peek(parser, PAREN_L))
+        {
+            eat(parser, PAREN_L);
+            property->has_range = true;
+            property->range_min = parse_integer(parser);
+            eat(parser, DOT);
+            eat(parser, DOT);
+            property->range_max = parse_integer(parser);
+            eat(parser, PAREN_R);
+        }
     }
 
     eat(parser, CURLY_R);
@@ -165,7 +201,7 @@ Expression *parse_precedence(Parser *parser, Precedence precedence)
     else if (peek(parser, NAME))
     {
         Token t = eat(parser, NAME);
-        lhs = NEW(Expression);
+        lhs = ARENA_NEW(parser->program->arena, Expression);
         lhs->variant = EXPR_VARIANT__UNRESOLVED_NAME;
         lhs->name = t.str;
     }
@@ -180,7 +216,7 @@ Expression *parse_precedence(Parser *parser, Precedence precedence)
         for (size_t i = 0; i < t.str.len; i++)
             num = num * 10 + ((int)(t.str.str[i]) - 48);
 
-        lhs = NEW(Expression);
+        lhs = ARENA_NEW(parser->program->arena, Expression);
         lhs->variant = EXPR_VARIANT__LITERAL;
         lhs->literal_value.type_primitive = TYPE_PRIMITIVE__NUMBER;
         lhs->literal_value.number = num;
@@ -236,7 +272,7 @@ Expression *parse_precedence(Parser *parser, Precedence precedence)
 
         eat(parser, t.kind);
 
-        Expression *expr = NEW(Expression);
+        Expression *expr = ARENA_NEW(parser->program->arena, Expression);
         expr->variant = EXPR_VARIANT__BIN_OP;
         expr->lhs = lhs;
         expr->op = operation;
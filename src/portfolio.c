@@ -0,0 +1,94 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "portfolio.h"
+#include "random.h"
+
+// PortfolioThread
+typedef struct
+{
+    QuantumMap *quantum_map; // The thread's own copy of the quantum map
+    Constraints constraints;
+    SolveOptions options;
+    SolveStats stats;
+    size_t index;
+    size_t *winner_index; // Shared by every thread (SIZE_MAX until a search finishes)
+} PortfolioThread;
+
+void *run_portfolio_thread(void *argument)
+{
+    PortfolioThread *thread = (PortfolioThread *)argument;
+    thread->stats = solve(thread->quantum_map, thread->constraints, thread->options);
+
+    if (thread->stats.status != SOLVE_STATUS__CANCELLED)
+    {
+        // Only the first search to finish wins, and cancels the others
+        size_t no_winner = SIZE_MAX;
+        if (__atomic_compare_exchange_n(thread->winner_index, &no_winner, thread->index, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            __atomic_store_n(thread->options.cancel, true, __ATOMIC_RELEASE);
+    }
+
+    return NULL;
+}
+
+// The variable order for each thread, starting from the one asked for and then cycling through the others
+VariableOrder portfolio_variable_order(VariableOrder order, size_t thread_index)
+{
+    VariableOrder orders[] = {VARIABLE_ORDER__LEXICAL, VARIABLE_ORDER__SMALLEST_DOMAIN, VARIABLE_ORDER__DOM_WDEG};
+    size_t orders_count = sizeof(orders) / sizeof(orders[0]);
+
+    size_t first = 0;
+    while (first < orders_count && orders[first] != order)
+        first++;
+
+    return orders[(first + thread_index) % orders_count];
+}
+
+// Solve portfolio
+PortfolioStats solve_portfolio(QuantumMap *quantum_map, Constraints constraints, SolveOptions options, size_t threads_count)
+{
+    bool cancel = false;
+    size_t winner_index = SIZE_MAX;
+
+    PortfolioThread *threads = (PortfolioThread *)malloc(sizeof(PortfolioThread) * threads_count);
+    pthread_t *thread_ids = (pthread_t *)malloc(sizeof(pthread_t) * threads_count);
+
+    for (size_t t = 0; t < threads_count; t++)
+    {
+        PortfolioThread *thread = threads + t;
+        thread->quantum_map = copy_quantum_map(quantum_map);
+        thread->constraints = constraints;
+        thread->options = options;
+        thread->options.variable_order = portfolio_variable_order(options.variable_order, t);
+        thread->options.seed = t == 0 ? options.seed : derive_seed(options.seed, t);
+        thread->options.cancel = &cancel;
+        thread->index = t;
+        thread->winner_index = &winner_index;
+
+        if (pthread_create(thread_ids + t, NULL, run_portfolio_thread, thread) != 0)
+        {
+            fprintf(stderr, "Unable to create solver thread\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for (size_t t = 0; t < threads_count; t++)
+        pthread_join(thread_ids[t], NULL);
+
+    // NOTE: Every search finishes unless it is cancelled, and searches are only cancelled once one has won
+    PortfolioThread *winner = threads + winner_index;
+    copy_domain_words(quantum_map, winner->quantum_map);
+
+    PortfolioStats stats;
+    stats.solve_stats = winner->stats;
+    stats.winner_index = winner_index;
+    stats.winner_order = winner->options.variable_order;
+
+    for (size_t t = 0; t < threads_count; t++)
+        free_quantum_map_copy(threads[t].quantum_map);
+    free(threads);
+    free(thread_ids);
+
+    return stats;
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#ifndef PORTFOLIO_H
+#define PORTFOLIO_H
+
+#include <stdlib.h>
+
+#include "constraints.h"
+#include "quantum_map.h"
+#include "solve.h"
+
+// Portfolio solving
+// How long a search takes can vary wildly with the random values it happens to try (and with the variable order).
+// Rather than betting on one search, several independent searches are run at once, each on its own thread with its
+// own copy of the quantum map's domains, its own random seed and (for every thread after the first) a different
+// variable order. The first search to finish wins: if it found a solution, its domains are copied into the quantum
+// map, and every other search is cancelled. As each search is complete, a search that finds there is no valid solution
+// also wins.
+
+// PortfolioStats
+typedef struct
+{
+    SolveStats solve_stats;     // The stats of the winning search
+    size_t winner_index;        // The thread the winning search ran on
+    VariableOrder winner_order; // The variable order the winning search used
+} PortfolioStats;
+
+PortfolioStats solve_portfolio(QuantumMap *quantum_map, Constraints constraints, SolveOptions options, size_t threads_count);
+
+#endif
\ No newline at end of file
@@ -28,6 +28,8 @@ void print_node(const Node *node)
         printf("%.*s: ", p.name.len, p.name.str);
         print_expr_type(p.type);
         printf(" (%.*s)", p.type_name.len, p.type_name.str);
+        if (p.has_range)
+            printf(" [%d..%d]", p.range_min, p.range_max);
     }
     printf(" }\n");
 }
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#include "arena.h"
 #include "expression.h"
 #include "sub_string.h"
 
@@ -17,6 +18,11 @@ struct Property
     sub_string name;
     sub_string type_name;
     ExprType type;
+
+    // The range of values a `num` property can take, if one was given (e.g. `num(0..1000)`)
+    bool has_range;
+    int range_min;
+    int range_max;
 };
 
 // Node
@@ -28,6 +34,7 @@ struct Node
     sub_string name;
     Property *properties;
     size_t properties_count;
+    size_t properties_capacity;
 };
 
 // Placeholder
@@ -49,6 +56,7 @@ struct Rule
 {
     Placeholder *placeholders;
     size_t placeholders_count;
+    size_t placeholders_capacity;
     Expression *expression;
 };
 
@@ -57,8 +65,11 @@ typedef struct
 {
     Node *nodes;
     size_t nodes_count;
+    size_t nodes_capacity;
     Rule *rules;
     size_t rules_count;
+    size_t rules_capacity;
+    Arena *arena; // Every expression of the program (and anything else made while parsing or resolving it)
 } Program;
 
 // Strings & printing
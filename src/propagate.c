@@ -0,0 +1,774 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "all_different.h"
+#include "arena.h"
+#include "bounds.h"
+#include "bytecode.h"
+#include "expression.h"
+#include "memory.h"
+#include "propagate.h"
+
+// Create propagator
+Propagator *create_propagator(QuantumMap *quantum_map, Constraints *constraints, Arena *arena)
+{
+    Propagator *propagator = ARENA_NEW(arena, Propagator);
+    propagator->quantum_map = quantum_map;
+    propagator->constraints = constraints;
+    propagator->trail = create_trail(quantum_map->variables_count + constraints->channel_watches_count);
+    propagator->nogoods = create_nogood_store(quantum_map->variables_count);
+
+    size_t arcs_count = constraints->multi_arcs_count;
+
+    // Queue
+    propagator->queue = ARENA_ARRAY(arena, size_t, arcs_count + 1);
+    propagator->queue_start = 0;
+    propagator->queue_count = 0;
+    propagator->arc_queued = ARENA_ZEROED_ARRAY(arena, bool, arcs_count + 1);
+
+    propagator->nogood_queue = ARENA_ARRAY(arena, size_t, NOGOODS_CAPACITY);
+    propagator->nogood_queue_count = 0;
+    propagator->nogood_queued = ARENA_ZEROED_ARRAY(arena, bool, NOGOODS_CAPACITY);
+
+    size_t all_differents_count = constraints->all_differents_count;
+    propagator->all_different_queue = ARENA_ARRAY(arena, size_t, all_differents_count + 1);
+    propagator->all_different_queue_count = 0;
+    propagator->all_different_queued = ARENA_ZEROED_ARRAY(arena, bool, all_differents_count + 1);
+
+    size_t matched_values_count = 0;
+    propagator->matched_values_offsets = ARENA_ARRAY(arena, size_t, all_differents_count + 1);
+    for (size_t a = 0; a < all_differents_count; a++)
+    {
+        propagator->matched_values_offsets[a] = matched_values_count;
+        matched_values_count += constraints->all_differents[a].variable_indexes_count;
+    }
+
+    propagator->matched_values = ARENA_ARRAY(arena, int, matched_values_count + 1);
+    for (size_t i = 0; i < matched_values_count; i++)
+        propagator->matched_values[i] = NO_VALUE;
+
+    propagator->all_different_work = create_all_different_work(constraints, arena);
+
+    // Single arcs on bounds variables, counted for each variable and then sliced
+    size_t variables_count = quantum_map->variables_count;
+    propagator->bounds_arcs_offsets = ARENA_ZEROED_ARRAY(arena, size_t, variables_count + 1);
+    for (size_t a = 0; a < constraints->single_arcs_count; a++)
+    {
+        size_t var_index = packed_arc_variables(constraints, constraints->single_arcs[a])[0];
+        if (quantum_map->variables[var_index].kind == DOMAIN_KIND__BOUNDS)
+            propagator->bounds_arcs_offsets[var_index + 1]++;
+    }
+
+    for (size_t v = 0; v < variables_count; v++)
+        propagator->bounds_arcs_offsets[v + 1] += propagator->bounds_arcs_offsets[v];
+
+    size_t bounds_arcs_count = propagator->bounds_arcs_offsets[variables_count];
+    propagator->bounds_arcs = ARENA_ARRAY(arena, size_t, bounds_arcs_count + 1);
+    size_t *bounds_arcs_filled = ARENA_ZEROED_ARRAY(arena, size_t, variables_count + 1);
+    for (size_t a = 0; a < constraints->single_arcs_count; a++)
+    {
+        size_t var_index = packed_arc_variables(constraints, constraints->single_arcs[a])[0];
+        if (quantum_map->variables[var_index].kind == DOMAIN_KIND__BOUNDS)
+            propagator->bounds_arcs[propagator->bounds_arcs_offsets[var_index] + bounds_arcs_filled[var_index]++] = a;
+    }
+
+    propagator->bounds_arc_queue = ARENA_ARRAY(arena, size_t, bounds_arcs_count + 1);
+    propagator->bounds_arc_queue_count = 0;
+    propagator->bounds_arc_queued = ARENA_ZEROED_ARRAY(arena, bool, constraints->single_arcs_count + 1);
+
+    propagator->watch_queue = ARENA_ARRAY(arena, size_t, constraints->channel_watches_count + 1);
+    propagator->watch_queue_count = 0;
+    propagator->watch_queued = ARENA_ZEROED_ARRAY(arena, bool, constraints->channel_watches_count + 1);
+
+    size_t seen_words_count = 0;
+    propagator->seen_words_offsets = ARENA_ARRAY(arena, size_t, constraints->channel_watches_count + 1);
+    for (size_t w = 0; w < constraints->channel_watches_count; w++)
+    {
+        ChannelWatch *watch = constraints->channel_watches + w;
+        propagator->seen_words_offsets[w] = seen_words_count;
+        if (watch->inverse)
+            seen_words_count += quantum_map->variables[channel_variable(constraints->channels + watch->channel_index, quantum_map, watch->instance_index, true)].words_count;
+    }
+    propagator->seen_words_offsets[constraints->channel_watches_count] = seen_words_count;
+
+    // Every variable starts with its full domain
+    propagator->seen_words = ARENA_ARRAY(arena, uint64_t, seen_words_count + 1);
+    for (size_t w = 0; w < constraints->channel_watches_count; w++)
+    {
+        ChannelWatch *watch = constraints->channel_watches + w;
+        if (watch->inverse)
+        {
+            size_t var_index = channel_variable(constraints->channels + watch->channel_index, quantum_map, watch->instance_index, true);
+            Domain seen = get_domain(quantum_map, var_index);
+            seen.words = propagator->seen_words + propagator->seen_words_offsets[w];
+            fill_domain(seen, quantum_map->variables[var_index].values_count);
+        }
+    }
+
+    propagator->conflict_var_index = 0;
+    propagator->conflict_reason = INITIAL_REASON;
+
+    propagator->arc_weights = ARENA_ARRAY(arena, size_t, arcs_count + 1);
+    for (size_t a = 0; a < arcs_count; a++)
+        propagator->arc_weights[a] = 1;
+
+    propagator->variable_weights = ARENA_ARRAY(arena, size_t, quantum_map->variables_count + 1);
+    for (size_t v = 0; v < quantum_map->variables_count; v++)
+        propagator->variable_weights[v] = reading_arcs_count(constraints, v) + variable_watches_count(constraints, v) + variable_all_differents_count(constraints, v) + 1;
+
+    propagator->arcs_revised = 0;
+    propagator->nogoods_checked = 0;
+    propagator->watches_revised = 0;
+    propagator->all_differents_revised = 0;
+
+    propagator->variable_marks = ARENA_ZEROED_ARRAY(arena, size_t, quantum_map->variables_count + 1);
+    propagator->mark_stamp = 0;
+
+    propagator->scratch_words = ARENA_ARRAY(arena, uint64_t, quantum_map->max_domain_words_count);
+    propagator->mask_words = ARENA_ARRAY(arena, uint64_t, quantum_map->max_domain_words_count * MAX_MASKS);
+
+    return propagator;
+}
+
+// Queueing arcs
+void queue_arc(Propagator *propagator, size_t arc_index)
+{
+    if (propagator->arc_queued[arc_index])
+        return;
+
+    size_t capacity = propagator->constraints->multi_arcs_count;
+    propagator->queue[(propagator->queue_start + propagator->queue_count) % capacity] = arc_index;
+    propagator->queue_count++;
+    propagator->arc_queued[arc_index] = true;
+}
+
+void queue_all_arcs(Propagator *propagator)
+{
+    for (size_t a = 0; a < propagator->constraints->multi_arcs_count; a++)
+        queue_arc(propagator, a);
+
+    for (size_t w = 0; w < propagator->constraints->channel_watches_count; w++)
+        queue_watch(propagator, w);
+
+    for (size_t a = 0; a < propagator->constraints->all_differents_count; a++)
+        queue_all_different(propagator, a);
+}
+
+void queue_nogood(Propagator *propagator, size_t slot)
+{
+    if (propagator->nogood_queued[slot])
+        return;
+
+    propagator->nogood_queue[propagator->nogood_queue_count++] = slot;
+    propagator->nogood_queued[slot] = true;
+}
+
+void queue_watch(Propagator *propagator, size_t watch_index)
+{
+    if (propagator->watch_queued[watch_index])
+        return;
+
+    propagator->watch_queue[propagator->watch_queue_count++] = watch_index;
+    propagator->watch_queued[watch_index] = true;
+}
+
+void queue_bounds_arc(Propagator *propagator, size_t arc_index)
+{
+    if (propagator->bounds_arc_queued[arc_index])
+        return;
+
+    propagator->bounds_arc_queue[propagator->bounds_arc_queue_count++] = arc_index;
+    propagator->bounds_arc_queued[arc_index] = true;
+}
+
+void queue_all_different(Propagator *propagator, size_t all_different_index)
+{
+    if (propagator->all_different_queued[all_different_index])
+        return;
+
+    propagator->all_different_queue[propagator->all_different_queue_count++] = all_different_index;
+    propagator->all_different_queued[all_different_index] = true;
+}
+
+void queue_arcs_reading(Propagator *propagator, size_t var_index)
+{
+    Constraints *constraints = propagator->constraints;
+    size_t count = reading_arcs_count(constraints, var_index);
+    size_t *arcs = reading_arcs_of(constraints, var_index);
+    for (size_t i = 0; i < count; i++)
+        queue_arc(propagator, arcs[i]);
+
+    for (size_t i = propagator->bounds_arcs_offsets[var_index]; i < propagator->bounds_arcs_offsets[var_index + 1]; i++)
+        queue_bounds_arc(propagator, propagator->bounds_arcs[i]);
+
+    size_t watches_count = variable_watches_count(constraints, var_index);
+    size_t *watches = variable_watches_of(constraints, var_index);
+    for (size_t i = 0; i < watches_count; i++)
+        queue_watch(propagator, watches[i]);
+
+    size_t all_differents_count = variable_all_differents_count(constraints, var_index);
+    size_t *all_differents = variable_all_differents_of(constraints, var_index);
+    for (size_t i = 0; i < all_differents_count; i++)
+        queue_all_different(propagator, all_differents[i]);
+
+    NogoodStore *nogoods = propagator->nogoods;
+    for (size_t i = 0; i < nogoods->watching_count[var_index]; i++)
+        queue_nogood(propagator, nogoods->watching[var_index][i]);
+}
+
+void clear_queue(Propagator *propagator)
+{
+    while (propagator->queue_count > 0)
+    {
+        size_t arc_index = propagator->queue[propagator->queue_start];
+        propagator->arc_queued[arc_index] = false;
+        propagator->queue_start = (propagator->queue_start + 1) % propagator->constraints->multi_arcs_count;
+        propagator->queue_count--;
+    }
+    propagator->queue_start = 0;
+
+    while (propagator->nogood_queue_count > 0)
+        propagator->nogood_queued[propagator->nogood_queue[--propagator->nogood_queue_count]] = false;
+
+    while (propagator->bounds_arc_queue_count > 0)
+        propagator->bounds_arc_queued[propagator->bounds_arc_queue[--propagator->bounds_arc_queue_count]] = false;
+
+    while (propagator->watch_queue_count > 0)
+        propagator->watch_queued[propagator->watch_queue[--propagator->watch_queue_count]] = false;
+
+    while (propagator->all_different_queue_count > 0)
+        propagator->all_different_queued[propagator->all_different_queue[--propagator->all_different_queue_count]] = false;
+}
+
+// Narrowing variables
+// The scratch domain has the same shape as the variable's domain, but is stored in the propagator's
+// scratch words (so it can be used to build up a new domain for the variable)
+Domain scratch_domain(Propagator *propagator, size_t var_index)
+{
+    QuantumVariable *variable = propagator->quantum_map->variables + var_index;
+    return (Domain){.kind = variable->kind, .words = propagator->scratch_words, .words_count = variable->words_count, .base = variable->base};
+}
+
+// Intersect the domain of a variable with `mask` (which must have the same shape as the variable's domain).
+// If this changes the domain, the previous domain is recorded on the trail (along with the reason it was
+// narrowed) and every arc that reads the variable is queued. Returns false if the variable has no possible values left.
+bool narrow_variable(Propagator *propagator, size_t var_index, Domain mask, Reason reason)
+{
+    Domain domain = get_domain(propagator->quantum_map, var_index);
+
+    if (domain_is_subset(domain, mask))
+        return !domain_is_empty(domain);
+
+    record_variable(propagator->trail, var_index, domain);
+    record_event(propagator->trail, var_index, reason);
+    intersect_domains(domain, mask);
+
+    if (domain_is_empty(domain))
+    {
+        propagator->conflict_var_index = var_index;
+        propagator->conflict_reason = reason;
+        return false;
+    }
+
+    queue_arcs_reading(propagator, var_index);
+    return true;
+}
+
+bool collapse_variable(Propagator *propagator, size_t var_index, int value, Reason reason)
+{
+    Domain mask = scratch_domain(propagator, var_index);
+    clear_domain(mask);
+    if (domain_contains(get_domain(propagator->quantum_map, var_index), value))
+        add_domain_value(mask, value);
+
+    return narrow_variable(propagator, var_index, mask, reason);
+}
+
+bool remove_variable_value(Propagator *propagator, size_t var_index, int value, Reason reason)
+{
+    Domain mask = scratch_domain(propagator, var_index);
+    fill_domain(mask, propagator->quantum_map->variables[var_index].values_count);
+    remove_domain_value(mask, value);
+
+    return narrow_variable(propagator, var_index, mask, reason);
+}
+
+// Revise arc with masks
+// Find every value of the arc's primary variable that is supported by some combination of values of the
+// arc's other variables, using the arc's mask bytecode. This tests every value of the primary variable at
+// once, so only the combinations of the other variables' values have to be stepped through.
+bool revise_arc_with_masks(Propagator *propagator, Arc *arc, Reason reason)
+{
+    QuantumMap *quantum_map = propagator->quantum_map;
+    MaskBytecode *mask_bytecode = arc->mask_bytecode;
+    size_t primary_index = arc->variable_indexes[0];
+    size_t total_variables = arc->variable_indexes_count;
+
+    Domain supported = scratch_domain(propagator, primary_index);
+    clear_domain(supported);
+
+    Domain var_domain[MAX_ARC_VARIABLES];
+    int registers[MAX_REGISTERS];
+    for (size_t n = 0; n < total_variables; n++)
+    {
+        var_domain[n] = get_domain(quantum_map, arc->variable_indexes[n]);
+
+        if (domain_is_empty(var_domain[n]))
+            return narrow_variable(propagator, primary_index, supported, reason);
+
+        registers[n] = first_domain_value(var_domain[n]);
+    }
+
+    Domain masks[MAX_MASKS];
+    for (size_t m = 0; m < mask_bytecode->masks_count; m++)
+    {
+        masks[m] = supported;
+        masks[m].words = propagator->mask_words + m * supported.words_count;
+    }
+
+    prepare_registers(mask_bytecode->bytecode, registers, arc->instance_indexes);
+
+    while (true)
+    {
+        run_mask_bytecode(mask_bytecode, registers, masks);
+        union_domains(supported, masks[mask_bytecode->result_mask]);
+
+        // Every value of the primary variable is supported, so there is no need to look any further
+        if (domain_is_subset(var_domain[0], supported))
+            break;
+
+        // Move onto the next set of possible values (excluding the primary variable)
+        size_t n = 1;
+        while (n < total_variables)
+        {
+            registers[n] = domain_value_after(var_domain[n], registers[n]);
+
+            if (registers[n] != NO_VALUE)
+                break;
+
+            registers[n] = first_domain_value(var_domain[n]);
+            n++;
+        }
+
+        if (n >= total_variables)
+            break;
+    }
+
+    return narrow_variable(propagator, primary_index, supported, reason);
+}
+
+// Revise arc with support table
+// Find every value of the arc's primary variable that is supported by some combination of values of the arc's
+// other variables, by combining the rows of the arc's support table for each of those combinations
+bool revise_arc_with_table(Propagator *propagator, Arc *arc, Reason reason)
+{
+    QuantumMap *quantum_map = propagator->quantum_map;
+    SupportTable *table = arc->support_table;
+    size_t primary_index = arc->variable_indexes[0];
+    size_t total_variables = arc->variable_indexes_count;
+
+    Domain primary_domain = get_domain(quantum_map, primary_index);
+    Domain supported = scratch_domain(propagator, primary_index);
+    clear_domain(supported);
+
+    Domain var_domain[MAX_ARC_VARIABLES];
+    int var_value[MAX_ARC_VARIABLES];
+    size_t row = 0;
+    for (size_t n = 1; n < total_variables; n++)
+    {
+        var_domain[n] = get_domain(quantum_map, arc->variable_indexes[n]);
+
+        if (domain_is_empty(var_domain[n]))
+            return narrow_variable(propagator, primary_index, supported, reason);
+
+        var_value[n] = first_domain_value(var_domain[n]);
+        row += (size_t)(var_value[n] - table->bases[n]) * table->strides[n];
+    }
+
+    Domain row_domain = supported;
+    while (true)
+    {
+        row_domain.words = table->rows + row * table->row_words_count;
+        union_domains(supported, row_domain);
+
+        // Every value of the primary variable is supported, so there is no need to look any further
+        if (domain_is_subset(primary_domain, supported))
+            break;
+
+        // Move onto the next set of possible values (excluding the primary variable)
+        size_t n = 1;
+        while (n < total_variables)
+        {
+            int value = domain_value_after(var_domain[n], var_value[n]);
+            if (value != NO_VALUE)
+            {
+                row += (size_t)(value - var_value[n]) * table->strides[n];
+                var_value[n] = value;
+                break;
+            }
+
+            value = first_domain_value(var_domain[n]);
+            row -= (size_t)(var_value[n] - value) * table->strides[n];
+            var_value[n] = value;
+            n++;
+        }
+
+        if (n >= total_variables)
+            break;
+    }
+
+    return narrow_variable(propagator, primary_index, supported, reason);
+}
+
+// Enforce single arc constraints
+// Returns false if any variable is left with no possible values
+bool enforce_single_arc_constraints(Propagator *propagator)
+{
+    QuantumMap *quantum_map = propagator->quantum_map;
+    Constraints *constraints = propagator->constraints;
+
+    for (size_t arc_index = 0; arc_index < constraints->single_arcs_count; arc_index++)
+    {
+        size_t variable_indexes[MAX_ARC_VARIABLES];
+        Arc unpacked = unpack_arc(constraints, constraints->single_arcs[arc_index], variable_indexes);
+        Arc *arc = &unpacked;
+
+        size_t var_index = arc->variable_indexes[0];
+
+        if (arc_has_bounds_variable(quantum_map, arc))
+        {
+            if (!revise_arc_bounds(propagator, arc, INITIAL_REASON))
+                return false;
+            continue;
+        }
+
+        if (arc->mask_bytecode != NULL)
+        {
+            if (!revise_arc_with_masks(propagator, arc, INITIAL_REASON))
+                return false;
+            continue;
+        }
+
+        Domain domain = get_domain(quantum_map, var_index);
+        Domain supported = scratch_domain(propagator, var_index);
+        clear_domain(supported);
+
+        int registers[MAX_REGISTERS];
+        prepare_registers(arc->bytecode, registers, arc->instance_indexes);
+
+        for (int value = first_domain_value(domain); value != NO_VALUE; value = domain_value_after(domain, value))
+        {
+            registers[0] = value;
+            int result = run_bytecode(arc->bytecode, registers);
+
+            if (result != 0)
+                add_domain_value(supported, value);
+        }
+
+        if (!narrow_variable(propagator, var_index, supported, INITIAL_REASON))
+            return false;
+    }
+
+    return true;
+}
+
+// Revise bounds arc
+// Narrow a bounds variable to the values a single arc allows, once the search has narrowed it. As the variable's
+// interval gets smaller (down to a single value, which is evaluated exactly), so does the interval of the arc's
+// expression, so values that break the arc are eventually removed even where the arc could not be projected exactly.
+bool revise_bounds_arc(Propagator *propagator, size_t arc_index)
+{
+    size_t variable_indexes[MAX_ARC_VARIABLES];
+    Arc unpacked = unpack_arc(propagator->constraints, propagator->constraints->single_arcs[arc_index], variable_indexes);
+    Reason reason = (Reason){.kind = REASON_KIND__SINGLE_ARC, .index = arc_index, .id = 0};
+    return revise_arc_bounds(propagator, &unpacked, reason);
+}
+
+// Revise multi arc
+// Remove every value of the arc's primary variable that is not supported by some combination
+// of values of the arc's other variables. Returns false if the primary variable is left with no possible values.
+
+bool revise_multi_arc(Propagator *propagator, size_t arc_index)
+{
+    size_t variable_indexes[MAX_ARC_VARIABLES];
+    Arc unpacked = unpack_arc(propagator->constraints, propagator->constraints->multi_arcs[arc_index], variable_indexes);
+    Arc *arc = &unpacked;
+    Reason reason = (Reason){.kind = REASON_KIND__ARC, .index = arc_index, .id = 0};
+    QuantumMap *quantum_map = propagator->quantum_map;
+
+    // Domain of each variable constrained by an arc
+    Domain var_domain[MAX_ARC_VARIABLES];
+#define primary_domain (var_domain[0]) // Access the first element of `var_domain` as `primary_domain`
+
+    // The value currently being tested for each variable is stored in the first registers of the arc's bytecode
+    int registers[MAX_REGISTERS];
+    int *var_value = registers;
+#define primary_value (var_value[0]) // Access the first element of `var_value` as `primary_value`
+
+    size_t primary_index = arc->variable_indexes[0];
+    size_t total_variables = arc->variable_indexes_count;
+
+    // Arcs on variables with bounds domains have too many combinations of values to test
+    if (arc_has_bounds_variable(quantum_map, arc))
+        return revise_arc_bounds(propagator, arc, reason);
+
+    if (arc->support_table != NULL)
+        return revise_arc_with_table(propagator, arc, reason);
+
+    if (arc->mask_bytecode != NULL)
+        return revise_arc_with_masks(propagator, arc, reason);
+
+    // The values of the primary variable that are supported are collected in the scratch domain
+    Domain supported = scratch_domain(propagator, primary_index);
+    clear_domain(supported);
+
+    // Store the domain of each variable that is constrained by the arc
+    for (size_t i = 0; i < total_variables; i++)
+    {
+        var_domain[i] = get_domain(quantum_map, arc->variable_indexes[i]);
+
+        // If any of the variables have no possible values, then no value of the primary variable can be supported
+        if (domain_is_empty(var_domain[i]))
+            return narrow_variable(propagator, primary_index, supported, reason);
+    }
+
+    prepare_registers(arc->bytecode, registers, arc->instance_indexes);
+
+    // Test each potential value for the first variable to see if it should be eliminated
+    for (primary_value = first_domain_value(primary_domain); primary_value != NO_VALUE; primary_value = domain_value_after(primary_domain, primary_value))
+    {
+        // Start from the first possible value of each other variable
+        for (size_t n = 1; n < total_variables; n++)
+            var_value[n] = first_domain_value(var_domain[n]);
+
+        while (true)
+        {
+            // Evaluate the set of possible variables to determine if the primary value is a valid possibility
+            int result = run_bytecode(arc->bytecode, registers);
+
+            if (result != 0)
+            {
+                add_domain_value(supported, primary_value);
+                break;
+            }
+
+            // Move onto the next set of possible values (excluding the primary variable)
+            size_t n = 1;
+            while (n < total_variables)
+            {
+                var_value[n] = domain_value_after(var_domain[n], var_value[n]);
+
+                if (var_value[n] != NO_VALUE)
+                    break;
+
+                var_value[n] = first_domain_value(var_domain[n]);
+                n++;
+            }
+
+            if (n >= total_variables)
+                break;
+        }
+    }
+
+    return narrow_variable(propagator, primary_index, supported, reason);
+#undef primary_domain
+#undef primary_value
+}
+
+// Check nogood
+// If every collapse in a nogood holds, then the current values are a dead end. If every collapse but one
+// holds, then that one cannot, and so the value is removed from that variable.
+bool check_nogood(Propagator *propagator, size_t slot)
+{
+    Nogood *nogood = propagator->nogoods->nogoods + slot;
+    Reason reason = (Reason){.kind = REASON_KIND__NOGOOD, .index = slot, .id = nogood->id};
+    QuantumMap *quantum_map = propagator->quantum_map;
+
+    NogoodLiteral *undecided = NULL;
+    for (size_t i = 0; i < nogood->literals_count; i++)
+    {
+        NogoodLiteral *literal = nogood->literals + i;
+        Domain domain = get_domain(quantum_map, literal->var_index);
+
+        // This collapse can no longer happen, so the nogood is satisfied
+        if (!domain_contains(domain, literal->value))
+            return true;
+
+        if (!domain_has_one_value(domain))
+        {
+            // More than one collapse has not yet happened, so there is nothing to infer
+            if (undecided != NULL)
+                return true;
+
+            undecided = literal;
+        }
+    }
+
+    // Every collapse in the nogood holds
+    if (undecided == NULL)
+    {
+        propagator->conflict_var_index = nogood->literals[0].var_index;
+        propagator->conflict_reason = reason;
+        return false;
+    }
+
+    return remove_variable_value(propagator, undecided->var_index, undecided->value, reason);
+}
+
+// Revise channel watch
+// For the channel between `x.forward` and `y.inverse`, `x.forward` can only be `y` if `y.inverse` can be `x`, and if
+// `x.forward` can only be `y`, then `y.inverse` must be `x`. When `y.inverse` is narrowed, only the instances `x` that
+// it can no longer refer to (since the watch was last revised) need to be checked. Each narrowing is between a single `x` and `y`, and is recorded with both of
+// their variables as its reason (so conflict analysis only follows the variables that were actually involved).
+bool revise_channel_watch(Propagator *propagator, size_t watch_index)
+{
+    QuantumMap *quantum_map = propagator->quantum_map;
+    ChannelWatch *watch = propagator->constraints->channel_watches + watch_index;
+    Channel *channel = propagator->constraints->channels + watch->channel_index;
+    size_t var_index = channel_variable(channel, quantum_map, watch->instance_index, watch->inverse);
+    Domain domain = get_domain(quantum_map, var_index);
+
+    // NOTE: Whenever `y.inverse` can no longer be `x`, its watch removes `y` from `x.forward`, so the only thing
+    //       left to check when `x.forward` is narrowed is whether it has been narrowed to a single instance
+    if (!watch->inverse)
+    {
+        size_t x = watch->instance_index;
+        if (domain_has_one_value(domain))
+        {
+            int y = first_domain_value(domain);
+            size_t inverse_index = channel_variable(channel, quantum_map, y, true);
+            Reason reason = (Reason){.kind = REASON_KIND__CHANNEL, .index = var_index, .id = inverse_index};
+            return collapse_variable(propagator, inverse_index, (int)x, reason);
+        }
+
+        return !domain_is_empty(domain);
+    }
+
+    // Find the instances `x` that `y.inverse` could refer to when it was last revised, but no longer can
+    Domain removed = domain;
+    removed.words = propagator->seen_words + propagator->seen_words_offsets[watch_index];
+    record_variable(propagator->trail, quantum_map->variables_count + watch_index, removed);
+    subtract_domains(removed, domain);
+
+    int y = (int)watch->instance_index;
+    for (int x = first_domain_value(removed); x != NO_VALUE; x = domain_value_after(removed, x))
+    {
+        size_t forward_index = channel_variable(channel, quantum_map, x, false);
+        if (!domain_contains(get_domain(quantum_map, forward_index), y))
+            continue;
+
+        Reason reason = (Reason){.kind = REASON_KIND__CHANNEL, .index = forward_index, .id = var_index};
+        if (!remove_variable_value(propagator, forward_index, y, reason))
+            return false;
+    }
+
+    copy_domain(removed, domain);
+    return !domain_is_empty(domain);
+}
+
+// Propagate
+// Revise queued arcs (and check queued nogoods) until there is no pending work left. Returns false
+// (and clears the queue) if any variable is left with no possible values. The variable and the reason
+// it was left with no values are stored in `conflict_var_index` and `conflict_reason`.
+bool propagate(Propagator *propagator)
+{
+    Constraints *constraints = propagator->constraints;
+
+    while (propagator->queue_count > 0 || propagator->nogood_queue_count > 0 || propagator->watch_queue_count > 0 ||
+           propagator->bounds_arc_queue_count > 0 || propagator->all_different_queue_count > 0)
+    {
+        // Nogoods are cheap to check, so they are checked before any arc is revised
+        if (propagator->nogood_queue_count > 0)
+        {
+            size_t slot = propagator->nogood_queue[--propagator->nogood_queue_count];
+            propagator->nogood_queued[slot] = false;
+            propagator->nogoods_checked++;
+
+            if (!check_nogood(propagator, slot))
+            {
+                clear_queue(propagator);
+                return false;
+            }
+
+            continue;
+        }
+
+        // Channel watches are also cheap to revise
+        if (propagator->watch_queue_count > 0)
+        {
+            size_t watch_index = propagator->watch_queue[--propagator->watch_queue_count];
+            propagator->watch_queued[watch_index] = false;
+            propagator->watches_revised++;
+
+            if (!revise_channel_watch(propagator, watch_index))
+            {
+                propagator->variable_weights[propagator->conflict_var_index]++;
+                clear_queue(propagator);
+                return false;
+            }
+
+            continue;
+        }
+
+        // NOTE: As with all different constraints, a bounds arc is only marked as no longer queued once it has been
+        //       revised, so that narrowing its own variable does not queue it again
+        if (propagator->bounds_arc_queue_count > 0)
+        {
+            size_t arc_index = propagator->bounds_arc_queue[--propagator->bounds_arc_queue_count];
+            propagator->arcs_revised++;
+
+            bool revised = revise_bounds_arc(propagator, arc_index);
+            propagator->bounds_arc_queued[arc_index] = false;
+
+            if (!revised)
+            {
+                propagator->variable_weights[propagator->conflict_var_index]++;
+                clear_queue(propagator);
+                return false;
+            }
+
+            continue;
+        }
+
+        if (propagator->queue_count > 0)
+        {
+            size_t arc_index = propagator->queue[propagator->queue_start];
+            propagator->queue_start = (propagator->queue_start + 1) % constraints->multi_arcs_count;
+            propagator->queue_count--;
+            propagator->arc_queued[arc_index] = false;
+
+            propagator->arcs_revised++;
+            if (!revise_multi_arc(propagator, arc_index))
+            {
+                PackedArc arc = constraints->multi_arcs[arc_index];
+                size_t *variables = packed_arc_variables(constraints, arc);
+                propagator->arc_weights[arc_index]++;
+                for (size_t n = 0; n < packed_arc_variables_count(constraints, arc); n++)
+                    propagator->variable_weights[variables[n]]++;
+
+                clear_queue(propagator);
+                return false;
+            }
+
+            continue;
+        }
+
+        // All different constraints are the most expensive to revise, so they wait until every arc has been revised.
+        // NOTE: A revision leaves the constraint at a fixed point, so it is only marked as no longer queued afterwards
+        //       (so that narrowing its own variables does not queue it again).
+        size_t all_different_index = propagator->all_different_queue[--propagator->all_different_queue_count];
+        propagator->all_differents_revised++;
+
+        bool revised = revise_all_different(propagator, all_different_index);
+        propagator->all_different_queued[all_different_index] = false;
+
+        if (!revised)
+        {
+            propagator->variable_weights[propagator->conflict_var_index]++;
+            clear_queue(propagator);
+            return false;
+        }
+    }
+
+    return true;
+}
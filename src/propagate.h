@@ -0,0 +1,117 @@
+#ifndef PROPAGATE_H
+#define PROPAGATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "constraints.h"
+#include "nogood.h"
+#include "quantum_map.h"
+#include "trail.h"
+
+// Forward declaration (see "all_different.h")
+typedef struct AllDifferentWork AllDifferentWork;
+
+// Propagator
+// Keeps a queue of the multi arcs that have pending work. Whenever the domain of a variable
+// is narrowed, every multi arc that reads that variable is queued so that it will be revised
+// again. `propagate` then revises arcs until the queue is empty (i.e. until a fixed point).
+// Every change made to a domain is recorded on the trail, so that it can be undone when backtracking.
+// Learned nogoods are checked in the same way, whenever one of their variables is narrowed.
+typedef struct
+{
+    QuantumMap *quantum_map;
+    Constraints *constraints;
+    Trail *trail; // Every change to a variable's domain is recorded on the trail so that it can be undone
+    NogoodStore *nogoods;
+
+    // Queue of multi arcs to revise (a ring buffer, each arc is queued at most once)
+    size_t *queue;
+    size_t queue_start;
+    size_t queue_count;
+    bool *arc_queued;
+
+    // Stack of nogood slots to check
+    size_t *nogood_queue;
+    size_t nogood_queue_count;
+    bool *nogood_queued;
+
+    // Stack of all different constraints to revise
+    size_t *all_different_queue;
+    size_t all_different_queue_count;
+    bool *all_different_queued;
+
+    // The value each all different constraint's variables are matched to (sliced by `matched_values_offsets`)
+    int *matched_values;
+    size_t *matched_values_offsets;
+    AllDifferentWork *all_different_work;
+
+    // Single arcs on bounds variables, sliced by variable in the same way as `reading_arcs`. Narrowing a bounds
+    // variable by its interval can miss values that break a single arc (e.g. `x * x = 7`), so these arcs are revised
+    // again whenever their variable is narrowed, rather than only once at the root.
+    size_t *bounds_arcs_offsets;
+    size_t *bounds_arcs;
+
+    // Stack of single arcs on bounds variables to revise
+    size_t *bounds_arc_queue;
+    size_t bounds_arc_queue_count;
+    bool *bounds_arc_queued;
+
+    // Stack of channel watches to revise
+    size_t *watch_queue;
+    size_t watch_queue_count;
+    bool *watch_queued;
+
+    // The domain each `y.inverse` watch's variable had when the watch was last revised, so that only the values removed
+    // since then need to be checked. These are recorded on the trail like variables are (after the quantum map's variables).
+    uint64_t *seen_words;
+    size_t *seen_words_offsets; // The last offset is the total number of seen words
+
+    // The variable that was left with no possible values by the last failed propagation, and why
+    size_t conflict_var_index;
+    Reason conflict_reason;
+
+    // Failure counters, used by the dom/wdeg variable order. Each time a multi arc leaves a variable with no
+    // possible values, its weight is incremented, as is the weight of each variable it constrains.
+    size_t *arc_weights;
+    size_t *variable_weights; // Starts as the number of arcs that read the variable
+
+    // Statistics
+    size_t arcs_revised;
+    size_t nogoods_checked;
+    size_t watches_revised;
+    size_t all_differents_revised;
+
+    // Marks used while explaining conflicts (see "conflict.h")
+    size_t *variable_marks;
+    size_t mark_stamp;
+
+    // Words used to build up a new domain for a variable before narrowing it
+    uint64_t *scratch_words;
+    uint64_t *mask_words; // `MAX_MASKS` domains worth of words, used when revising arcs with mask bytecode
+} Propagator;
+
+// Everything the propagator allocates (other than its trail and nogood store, which grow) comes from `arena`
+Propagator *create_propagator(QuantumMap *quantum_map, Constraints *constraints, Arena *arena);
+
+// Queueing arcs
+void queue_all_arcs(Propagator *propagator);
+void queue_arcs_reading(Propagator *propagator, size_t var_index);
+void queue_nogood(Propagator *propagator, size_t slot);
+void queue_watch(Propagator *propagator, size_t watch_index);
+void queue_bounds_arc(Propagator *propagator, size_t arc_index);
+void queue_all_different(Propagator *propagator, size_t all_different_index);
+void clear_queue(Propagator *propagator);
+
+// Narrowing variables
+Domain scratch_domain(Propagator *propagator, size_t var_index);
+bool narrow_variable(Propagator *propagator, size_t var_index, Domain mask, Reason reason);
+bool collapse_variable(Propagator *propagator, size_t var_index, int value, Reason reason);
+bool remove_variable_value(Propagator *propagator, size_t var_index, int value, Reason reason);
+
+// Enforcing constraints
+bool enforce_single_arc_constraints(Propagator *propagator);
+bool propagate(Propagator *propagator);
+
+#endif
\ No newline at end of file
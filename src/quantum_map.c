@@ -1,25 +1,25 @@
 #include <stdio.h>
+#include <string.h>
 
 #include "memory.h"
 #include "quantum_map.h"
 
 // Create quantum map
-
-// TODO: Instead of having a fixed "INSTANCES_PER_NODE_DEC", have the number of
-//       instances of each node type be passed as an argument into the function
-const size_t INSTANCES_PER_NODE_DEC = 8;
-QuantumMap *create_quantum_map(Program *program)
+QuantumMap *create_quantum_map(Program *program, size_t *node_instances_count)
 {
     QuantumMap *quantum_map = NEW(QuantumMap);
-    quantum_map->instances_count = program->nodes_count * INSTANCES_PER_NODE_DEC;
-    quantum_map->instances = (QuantumInstance *)malloc(sizeof(QuantumInstance) * quantum_map->instances_count);
+    quantum_map->instances_count = 0;
+    for (size_t i = 0; i < program->nodes_count; i++)
+        quantum_map->instances_count += node_instances_count[i];
+
+    quantum_map->instances = (QuantumInstance *)malloc(sizeof(QuantumInstance) * (quantum_map->instances_count + 1));
 
     size_t instance_index = 0;
     size_t var_index = 0;
     for (size_t i = 0; i < program->nodes_count; i++)
     {
         Node *node = program->nodes + i;
-        for (size_t j = 0; j < INSTANCES_PER_NODE_DEC; j++)
+        for (size_t j = 0; j < node_instances_count[i]; j++)
         {
             QuantumInstance *instance = quantum_map->instances + instance_index;
             instance->node = node;
@@ -31,24 +31,136 @@ QuantumMap *create_quantum_map(Program *program)
     }
 
     quantum_map->variables_count = var_index;
-    quantum_map->variables = (uint64_t *)malloc(sizeof(uint64_t) * quantum_map->variables_count);
+    quantum_map->variables = (QuantumVariable *)malloc(sizeof(QuantumVariable) * (quantum_map->variables_count + 1));
+
+    // Record where the instances of each node are
+    quantum_map->nodes = program->nodes;
+    quantum_map->nodes_count = program->nodes_count;
+    quantum_map->node_first_instance = (size_t *)malloc(sizeof(size_t) * program->nodes_count);
+    quantum_map->node_instances_count = (size_t *)malloc(sizeof(size_t) * program->nodes_count);
+    size_t first_instance = 0;
+    for (size_t i = 0; i < program->nodes_count; i++)
+    {
+        quantum_map->node_first_instance[i] = first_instance;
+        quantum_map->node_instances_count[i] = node_instances_count[i];
+        first_instance += node_instances_count[i];
+    }
+
+    // Lay out the domain of each variable
+    size_t words_offset = 0;
+    quantum_map->max_domain_words_count = 1;
+    for (size_t i = 0; i < quantum_map->instances_count; i++)
+    {
+        QuantumInstance *instance = quantum_map->instances + i;
+        Node *node = instance->node;
+
+        for (size_t p = 0; p < node->properties_count; p++)
+        {
+            Property *property = node->properties + p;
+            QuantumVariable *variable = quantum_map->variables + instance->variables_array_index + p;
+
+            variable->kind = DOMAIN_KIND__BITFIELD;
+
+            if (property->type.primitive == TYPE_PRIMITIVE__NUMBER && property->has_range)
+            {
+                variable->base = property->range_min;
+                variable->values_count = (size_t)((int64_t)property->range_max - property->range_min + 1);
+
+                if (variable->values_count > MAX_BITFIELD_VALUES_COUNT)
+                    variable->kind = DOMAIN_KIND__BOUNDS;
+            }
+
+            else if (property->type.primitive == TYPE_PRIMITIVE__NUMBER)
+            {
+                variable->base = 0;
+                variable->values_count = NUMBER_VALUES_COUNT;
+            }
+
+            else if (property->type.primitive == TYPE_PRIMITIVE__BOOL)
+            {
+                variable->base = 0;
+                variable->values_count = 2;
+            }
+
+            else if (property->type.primitive == TYPE_PRIMITIVE__NODE)
+            {
+                size_t n = property->type.node - program->nodes;
+                variable->base = (int)quantum_map->node_first_instance[n];
+                variable->values_count = quantum_map->node_instances_count[n];
+            }
+
+            else
+            {
+                fprintf(stderr, "Internal error: Encountered %s while creating quantum map", type_primitive_string(property->type.primitive));
+                exit(EXIT_FAILURE);
+            }
+
+            variable->words_count = variable->kind == DOMAIN_KIND__BOUNDS ? BOUNDS_WORDS_COUNT : words_for_values(variable->values_count);
+            if (variable->kind == DOMAIN_KIND__BITFIELD && variable->words_count > 1)
+            {
+                variable->words_count = (variable->words_count + DOMAIN_WORDS_ALIGNMENT - 1) / DOMAIN_WORDS_ALIGNMENT * DOMAIN_WORDS_ALIGNMENT;
+                words_offset = (words_offset + DOMAIN_WORDS_ALIGNMENT - 1) / DOMAIN_WORDS_ALIGNMENT * DOMAIN_WORDS_ALIGNMENT;
+            }
+
+            variable->words_offset = words_offset;
+            words_offset += variable->words_count;
+
+            if (variable->words_count > quantum_map->max_domain_words_count)
+                quantum_map->max_domain_words_count = variable->words_count;
+        }
+    }
+
+    quantum_map->domain_words_count = words_offset;
+    quantum_map->domain_words = ALIGNED_ALLOC(uint64_t, 64, words_offset + 1);
+
+    for (size_t v = 0; v < quantum_map->variables_count; v++)
+        reset_domain(quantum_map, v);
 
     return quantum_map;
 }
 
-// Bitfields
-bool value_in_bitfield(int value, uint64_t bitfield)
+// Copy quantum map
+// The copy shares everything with the original except for the words of each variable's domain, so that it can be
+// solved separately (e.g. by another thread)
+QuantumMap *copy_quantum_map(QuantumMap *quantum_map)
 {
-    return (bitfield & (1ULL << value)) > 0;
+    QuantumMap *copy = NEW(QuantumMap);
+    memcpy(copy, quantum_map, sizeof(QuantumMap));
+    copy->domain_words = ALIGNED_ALLOC(uint64_t, 64, quantum_map->domain_words_count + 1);
+    copy_domain_words(copy, quantum_map);
+    return copy;
 }
 
-// Printing & strings
-void print_bitfield(uint64_t bitfield)
+void copy_domain_words(QuantumMap *to, QuantumMap *from)
 {
-    for (int i = 63; i >= 0; i--)
-        putchar(value_in_bitfield(i, bitfield) ? '1' : '0');
+    memcpy(to->domain_words, from->domain_words, sizeof(uint64_t) * from->domain_words_count);
 }
 
+void free_quantum_map_copy(QuantumMap *copy)
+{
+    ALIGNED_FREE(copy->domain_words);
+    free(copy);
+}
+
+// Domains
+Domain get_domain(QuantumMap *quantum_map, size_t var_index)
+{
+    QuantumVariable *variable = quantum_map->variables + var_index;
+    return (Domain){
+        .kind = variable->kind,
+        .words = quantum_map->domain_words + variable->words_offset,
+        .words_count = variable->words_count,
+        .base = variable->base,
+    };
+}
+
+// Set the domain of a variable to every value it could possibly take
+void reset_domain(QuantumMap *quantum_map, size_t var_index)
+{
+    fill_domain(get_domain(quantum_map, var_index), quantum_map->variables[var_index].values_count);
+}
+
+// Printing & strings
 void print_quantum_map(QuantumMap *quantum_map)
 {
     for (size_t i = 0; i < quantum_map->instances_count; i++)
@@ -62,9 +174,9 @@ void print_quantum_map(QuantumMap *quantum_map)
         for (size_t p = 0; p < node->properties_count; p++)
         {
             Property *property = node->properties + p;
-            uint64_t *var_bitfield = quantum_map->variables + (instance->variables_array_index + p);
+            size_t var_index = instance->variables_array_index + p;
             printf("\t%.*s:\t", property->name.len, property->name.str);
-            print_bitfield(*var_bitfield);
+            print_domain(get_domain(quantum_map, var_index), quantum_map->variables[var_index].values_count);
             printf("\n");
         }
     }
@@ -3,12 +3,19 @@
 
 #include <stdint.h>
 
+#include "domain.h"
 #include "program.h"
 
 // CLEANUP: Split data structure and `create_quantum_map` into separate source files.
 
 // CLEANUP: Figure out a better name for this than "quantum map"
 
+// The number of values a `num` property can take if it is not given a range (0 to NUMBER_VALUES_COUNT - 1)
+#define NUMBER_VALUES_COUNT 64
+
+// Ranges with more values than this are stored as bounds, rather than as bitfields
+#define MAX_BITFIELD_VALUES_COUNT 1024
+
 // QuantumInstance
 typedef struct
 {
@@ -16,23 +23,58 @@ typedef struct
     size_t variables_array_index;
 } QuantumInstance;
 
+// QuantumVariable
+// Where the domain of a variable is stored in the quantum map's `domain_words`, and how it should be
+// read. Bit `n` of the domain represents the value `base + n`, and only the first `values_count` bits
+// are ever set (or, for bounds, the domain is at most `base` to `base + values_count - 1`). Domains that span more than one word are padded to a multiple of `DOMAIN_WORDS_ALIGNMENT`
+// words, and start on a multiple of `DOMAIN_WORDS_ALIGNMENT` words, so that they can be processed in blocks.
+#define DOMAIN_WORDS_ALIGNMENT 4
+
+typedef struct
+{
+    DomainKind kind;
+    size_t words_offset;
+    size_t words_count;
+    int base;
+    size_t values_count;
+} QuantumVariable;
+
 // QuantumMap
 typedef struct
 {
     QuantumInstance *instances;
     size_t instances_count;
-    uint64_t *variables;
+    QuantumVariable *variables;
     size_t variables_count;
+
+    // The words of every variable's domain, stored contiguously
+    uint64_t *domain_words;
+    size_t domain_words_count;
+    size_t max_domain_words_count; // The most words any one variable's domain spans
+
+    // The instances of each node are stored contiguously (indexed in the same order as `Program::nodes`)
+    Node *nodes;
+    size_t nodes_count;
+    size_t *node_first_instance;
+    size_t *node_instances_count;
 } QuantumMap;
 
 // Create quantum map
-QuantumMap *create_quantum_map(Program *program);
+// `node_instances_count` gives the number of instances of each node (indexed in the same order as `Program::nodes`)
+#define DEFAULT_INSTANCES_PER_NODE 8
+
+QuantumMap *create_quantum_map(Program *program, size_t *node_instances_count);
+
+// Copying quantum maps
+QuantumMap *copy_quantum_map(QuantumMap *quantum_map);
+void copy_domain_words(QuantumMap *to, QuantumMap *from);
+void free_quantum_map_copy(QuantumMap *copy);
 
-// Bitfields
-bool value_in_bitfield(int value, uint64_t bitfield);
+// Domains
+Domain get_domain(QuantumMap *quantum_map, size_t var_index);
+void reset_domain(QuantumMap *quantum_map, size_t var_index);
 
 // Printing & strings
-void print_bitfield(uint64_t bitfield);
 void print_quantum_map(QuantumMap *quantum_map);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,32 @@
+#include "random.h"
+
+// Mix the bits of `x` (the finaliser of splitmix64)
+uint64_t mix_bits(uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Create random
+Random create_random(uint64_t seed)
+{
+    // xorshift gets stuck on a state of 0
+    uint64_t state = mix_bits(seed);
+    return (Random){.state = state != 0 ? state : 0x9E3779B97F4A7C15ULL};
+}
+
+uint64_t next_random(Random *random)
+{
+    uint64_t x = random->state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    random->state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+uint64_t derive_seed(uint64_t seed, uint64_t index)
+{
+    return mix_bits(seed + index * 0x9E3779B97F4A7C15ULL);
+}
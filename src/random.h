@@ -0,0 +1,20 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <stdint.h>
+
+// Random
+// A small pseudo-random number generator (xorshift64*). Each solver has its own, so that solvers running at the
+// same time do not share (or fight over) the state of `rand()`, and a solve can be repeated from its seed.
+typedef struct
+{
+    uint64_t state;
+} Random;
+
+Random create_random(uint64_t seed);
+uint64_t next_random(Random *random);
+
+// Derive a seed for the `index`th of several generators from one seed, so that their streams are unrelated
+uint64_t derive_seed(uint64_t seed, uint64_t index);
+
+#endif
\ No newline at end of file
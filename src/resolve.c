@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "arena.h"
 #include "memory.h"
 #include "resolve.h"
 
@@ -12,6 +13,7 @@ typedef struct
 {
     Expression *conditions;
     size_t conditions_count;
+    size_t conditions_capacity;
 } RuleConditions;
 
 Expression *resolve_expression(Program *program, Rule *rule, Expression *expr, RuleConditions *conditions);
@@ -84,6 +86,19 @@ void resolve(Program *program)
                 fprintf(stderr, "Type '%.*s' of '%.*s' property does not exist.", property->type_name.len, property->type_name.str, property->name.len, property->name.str);
                 exit(EXIT_FAILURE);
             }
+
+            // Check the property's range
+            if (property->has_range && property->type.primitive != TYPE_PRIMITIVE__NUMBER)
+            {
+                fprintf(stderr, "'%.*s' property has a range, but only num properties can have a range", property->name.len, property->name.str);
+                exit(EXIT_FAILURE);
+            }
+
+            if (property->has_range && property->range_min > property->range_max)
+            {
+                fprintf(stderr, "'%.*s' property has an empty range (%d..%d)", property->name.len, property->name.str, property->range_min, property->range_max);
+                exit(EXIT_FAILURE);
+            }
         }
     }
 
@@ -135,7 +150,7 @@ void resolve(Program *program)
         Expression *expr = resolve_expression(program, rule, rule->expression, &conditions);
         for (size_t i = 0; i < conditions.conditions_count; i++)
         {
-            Expression *conditional_expr = NEW(Expression);
+            Expression *conditional_expr = ARENA_NEW(program->arena, Expression);
             conditional_expr->variant = EXPR_VARIANT__BIN_OP;
             conditional_expr->op = OPERATION__LOGICAL_OR;
             conditional_expr->lhs = conditions.conditions + i;
@@ -209,7 +224,7 @@ Expression *resolve_expression(Program *program, Rule *rule, Expression *expr, R
 
             // Convert BIN_OP to PROPERTY_ACCESS
 
-            Expression *property_access = NEW(Expression);
+            Expression *property_access = ARENA_NEW(program->arena, Expression);
             property_access->variant = EXPR_VARIANT__PROPERTY_ACCESS;
             property_access->property_name = property_name;
 
@@ -227,7 +242,7 @@ Expression *resolve_expression(Program *program, Rule *rule, Expression *expr, R
                 intermediate->index = rule->placeholders_count - 1;
                 intermediate->type = subject_type;
                 intermediate->type_name = NULL_SUB_STRING;
-                char *temp_str = (char *)malloc(sizeof(char) * property_name.len + 2); // FIXME: This is a memory leak!
+                char *temp_str = ARENA_ARRAY(program->arena, char, property_name.len + 2);
                 temp_str[0] = '~';
                 strncpy(temp_str + 1, property_name.str, property_name.len);
                 temp_str[property_name.len + 1] = '\0';
@@ -243,7 +258,7 @@ Expression *resolve_expression(Program *program, Rule *rule, Expression *expr, R
                 condition->variant = EXPR_VARIANT__BIN_OP;
                 condition->op = OPERATION__NOT_EQUAL_TO;
 
-                condition->lhs = NEW(Expression);
+                condition->lhs = ARENA_NEW(program->arena, Expression);
                 condition->lhs->variant = EXPR_VARIANT__PLACEHOLDER_VALUE;
                 condition->lhs->placeholder_value_index = intermediate->index;
 
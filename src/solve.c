@@ -1,389 +1,516 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
+#include "arena.h"
+#include "conflict.h"
 #include "expression.h"
+#include "memory.h"
+#include "propagate.h"
+#include "random.h"
 #include "solve.h"
+#include "work_stealing.h"
 
-// Evaluate arc expression
-int evaluate_arc_expression(Arc *arc, Expression *expr, int *variable_values, size_t *instance_values)
+// Reset solution values
+// Set the domain of every variable to every value it could possibly take
+void reset_solution_values(QuantumMap *quantum_map)
 {
+    for (size_t v = 0; v < quantum_map->variables_count; v++)
+        reset_domain(quantum_map, v);
+}
 
-    switch (expr->variant)
-    {
+// Learn nogood
+// The collapses made at each level in `levels` are known to lead to a conflict, so learn them as a nogood
+void learn_nogood_from_levels(Propagator *propagator, LevelSet *levels, size_t *decision_var, int *decision_value, SolveStats *stats)
+{
+    if (levels->levels_count > MAX_NOGOOD_LITERALS)
+        return;
 
-        // TODO: There's no need to convert from a ExprValue to an int every time - do this ahead of time!
-    case EXPR_VARIANT__LITERAL:
+    NogoodLiteral literals[MAX_NOGOOD_LITERALS];
+    for (size_t i = 0; i < levels->levels_count; i++)
     {
-        if (expr->literal_value.type_primitive == TYPE_PRIMITIVE__NUMBER)
-            return expr->literal_value.number;
-        if (expr->literal_value.type_primitive == TYPE_PRIMITIVE__BOOL)
-            return expr->literal_value.boolean ? 1 : 0;
-
-        fprintf(stderr, "Unable to evaluate expression literal\n");
-        print_expression(expr);
-        exit(EXIT_FAILURE);
+        size_t level = levels->levels[i];
+        literals[i].var_index = decision_var[level];
+        literals[i].value = decision_value[level];
     }
 
-    case EXPR_VARIANT__BIN_OP:
+    size_t slot = learn_nogood(propagator->nogoods, literals, levels->levels_count);
+    if (slot < NOGOODS_CAPACITY)
     {
-        int rhs = evaluate_arc_expression(arc, expr->rhs, variable_values, instance_values);
-        int lhs = evaluate_arc_expression(arc, expr->lhs, variable_values, instance_values);
-
-        if (expr->op == OPERATION__MUL)
-            return lhs * rhs;
-        if (expr->op == OPERATION__DIV)
-            return lhs / rhs;
-        if (expr->op == OPERATION__ADD)
-            return lhs + rhs;
-        if (expr->op == OPERATION__SUB)
-            return lhs - rhs;
-
-        if (expr->op == OPERATION__LESS_THAN)
-            return lhs < rhs;
-        if (expr->op == OPERATION__MORE_THAN)
-            return lhs > rhs;
-        if (expr->op == OPERATION__LESS_THAN_OR_EQUAL)
-            return lhs <= rhs;
-        if (expr->op == OPERATION__MORE_THAN_OR_EQUAL)
-            return lhs <= rhs;
-
-        if (expr->op == OPERATION__EQUAL_TO)
-            return lhs == rhs;
-        if (expr->op == OPERATION__NOT_EQUAL_TO)
-            return lhs != rhs;
-
-        if (expr->op == OPERATION__LOGICAL_AND)
-            return lhs && rhs;
-        if (expr->op == OPERATION__LOGICAL_OR)
-            return lhs || rhs;
-
-        fprintf(stderr, "Unable to evaluate %s binary operation\n", operation_string(expr->op));
-        print_expression(expr);
-        exit(EXIT_FAILURE);
+        queue_nogood(propagator, slot);
+        stats->nogoods_learned++;
     }
+}
 
-    case EXPR_VARIANT__VARIABLE_REFERENCE_INDEX:
-    {
-        size_t index = (expr->variable_reference_index + arc->expr_rotation) % arc->variable_indexes_count;
-        return variable_values[index];
-    }
+// Record the statistics counted by the propagator
+void record_propagator_stats(SolveStats *stats, Propagator *propagator)
+{
+    stats->arcs_revised = propagator->arcs_revised;
+    stats->nogoods_checked = propagator->nogoods_checked;
+    stats->watches_revised = propagator->watches_revised;
+    stats->all_differents_revised = propagator->all_differents_revised;
+}
 
-    case EXPR_VARIANT__INSTANCE_REFERENCE_INDEX:
+bool solve_cancelled(SolveOptions *options)
+{
+    return options->cancel != NULL && __atomic_load_n(options->cancel, __ATOMIC_RELAXED);
+}
+
+// Search tasks
+SearchTask *create_search_task(size_t *prefix_var, int *prefix_value, size_t prefix_count, size_t var_index, Domain values)
+{
+    SearchTask *task = NEW(SearchTask);
+    task->prefix_var = (size_t *)malloc(sizeof(size_t) * prefix_count);
+    task->prefix_value = (int *)malloc(sizeof(int) * prefix_count);
+    task->prefix_count = prefix_count;
+    for (size_t p = 0; p < prefix_count; p++)
     {
-        return instance_values[expr->instance_reference_index];
+        task->prefix_var[p] = prefix_var[p];
+        task->prefix_value[p] = prefix_value[p];
     }
 
-    default:
+    task->var_index = var_index;
+    task->values = values;
+    task->values.words = (uint64_t *)malloc(sizeof(uint64_t) * values.words_count);
+    copy_domain(task->values, values);
+    return task;
+}
+
+void free_search_task(SearchTask *task)
+{
+    free(task->prefix_var);
+    free(task->prefix_value);
+    free(task->values.words);
+    free(task);
+}
+
+// Create search
+Search *create_search(QuantumMap *quantum_map, Constraints *constraints, SolveOptions options, Arena *arena)
+{
+    Search *search = ARENA_NEW(arena, Search);
+    search->quantum_map = quantum_map;
+    search->propagator = create_propagator(quantum_map, constraints, arena);
+    search->options = options;
+    search->random = create_random(options.seed);
+
+    // NOTE: Variables that have already been narrowed to a single value are never collapsed, so there
+    //       can be at most one level per variable.
+    size_t levels_count = quantum_map->variables_count + 1;
+    search->levels_count = levels_count;
+    search->decision_var = ARENA_ARRAY(arena, size_t, levels_count);
+    search->decision_var[0] = 0;
+    search->decision_value = ARENA_ARRAY(arena, int, levels_count);
+    search->level_shared = ARENA_ZEROED_ARRAY(arena, bool, levels_count);
+    search->task_level = 0;
+
+    // The values left to try at each level. As the variable collapsed at each level may have a different
+    // number of words, their words are stored one after another on a stack. Each variable is collapsed at
+    // most once, so the stack never needs more words than the quantum map does.
+    search->remaining_values_for = ARENA_ARRAY(arena, Domain, levels_count);
+    search->remaining_words = ARENA_ARRAY(arena, uint64_t, quantum_map->domain_words_count);
+    search->remaining_values_for[0] = (Domain){.kind = DOMAIN_KIND__BITFIELD, .words = search->remaining_words, .words_count = 0, .base = 0};
+
+    // The levels that are known to be involved in the conflicts of each value tried at a level
+    search->conflict_sets = ARENA_ARRAY(arena, LevelSet, levels_count);
+    for (size_t l = 0; l < levels_count; l++)
+        init_level_set(search->conflict_sets + l);
+    init_level_set(&search->conflict);
+
+    search->pool = NULL;
+    search->worker_index = 0;
+
+    reset_search_stats(search);
+    return search;
+}
+
+void reset_search_stats(Search *search)
+{
+    Propagator *propagator = search->propagator;
+    propagator->arcs_revised = 0;
+    propagator->nogoods_checked = 0;
+    propagator->watches_revised = 0;
+    propagator->all_differents_revised = 0;
+
+    SolveStats *stats = &search->stats;
+    stats->status = SOLVE_STATUS__SOLVED;
+    stats->decisions = 0;
+    stats->conflicts = 0;
+    stats->backjumps = 0;
+    stats->levels_skipped = 0;
+    stats->nogoods_learned = 0;
+    stats->max_level = 0;
+    stats->seconds = 0;
+    record_propagator_stats(stats, propagator);
+}
+
+void free_search(Search *search)
+{
+    for (size_t l = 0; l < search->levels_count; l++)
+        free(search->conflict_sets[l].levels);
+    free(search->conflict.levels);
+}
+
+// Enforce root constraints
+bool enforce_root_constraints(Search *search)
+{
+    QuantumMap *quantum_map = search->quantum_map;
+    Propagator *propagator = search->propagator;
+
+    reset_solution_values(quantum_map);
+
+    bool valid_solution = true;
+    for (size_t n = 0; n < quantum_map->variables_count; n++)
     {
-        fprintf(stderr, "Unable to evaluate %s expression\n", expr_variant_string(expr->variant));
-        print_expression(expr);
-        exit(EXIT_FAILURE);
-    }
+        if (domain_is_empty(get_domain(quantum_map, n)))
+        {
+            valid_solution = false;
+            break;
+        }
     }
+
+    queue_all_arcs(propagator);
+    valid_solution = valid_solution && enforce_single_arc_constraints(propagator);
+    valid_solution = valid_solution && propagate(propagator);
+    clear_queue(propagator);
+
+    record_propagator_stats(&search->stats, propagator);
+    return valid_solution;
 }
 
-// Apply arc constraints
-void enforce_single_arc_constrains(QuantumMap *quantum_map, Constraints constraints)
+// Levels
+// Push a level that collapses `var_index`, with `values` left to try at it
+void push_search_level(Search *search, size_t level, size_t var_index, Domain values)
 {
-    for (size_t arc_index = 0; arc_index < constraints.single_arcs_count; arc_index++)
-    {
-        Arc *arc = constraints.single_arcs + arc_index;
+    search->decision_var[level] = var_index;
 
-        size_t var_index = arc->variable_indexes[0];
-        uint64_t var_bitfield = quantum_map->variables[var_index];
+    Domain *previous = search->remaining_values_for + level - 1;
+    search->remaining_values_for[level] = (Domain){.kind = values.kind, .words = previous->words + previous->words_count, .words_count = values.words_count, .base = values.base};
+    copy_domain(search->remaining_values_for[level], values);
+    clear_level_set(search->conflict_sets + level);
+    search->level_shared[level] = false;
+    push_level(search->propagator->trail);
 
-        for (int value = 0; value < 64; value++)
-        {
-            uint64_t value_bitfield = (1ULL << value);
-            if (!(var_bitfield & value_bitfield))
-                continue;
+    if (level > search->stats.max_level)
+        search->stats.max_level = level;
+}
 
-            int result = evaluate_arc_expression(arc, arc->expr, &value, arc->instance_indexes);
+// Start task
+// Make each collapse of the task's prefix, and then push the level of the task's variable. The prefix was
+// propagated by the search that made the task (which may have known more nogoods than this search), so a prefix that
+// fails here has no valid solution below it. Returns false if there is nothing left to try.
+bool start_search_task(Search *search, SearchTask *task, size_t *level)
+{
+    QuantumMap *quantum_map = search->quantum_map;
+    Propagator *propagator = search->propagator;
+    Domain no_values = {.kind = DOMAIN_KIND__BITFIELD, .words = NULL, .words_count = 0, .base = 0};
 
-            if (result == 0)
-                var_bitfield -= value_bitfield;
-        }
+    for (size_t p = 0; p < task->prefix_count; p++)
+    {
+        size_t var_index = task->prefix_var[p];
+
+        // The levels of the prefix have no values left to try
+        (*level)++;
+        push_search_level(search, *level, var_index, no_values);
+        search->level_shared[*level] = true;
+        search->decision_value[*level] = task->prefix_value[p];
 
-        quantum_map->variables[var_index] = var_bitfield;
+        if (!domain_contains(get_domain(quantum_map, var_index), task->prefix_value[p]))
+            return false;
+
+        if (!collapse_variable(propagator, var_index, task->prefix_value[p], DECISION_REASON) || !propagate(propagator))
+        {
+            clear_queue(propagator);
+            return false;
+        }
     }
-}
 
-// TODO: Support for more than a fixed number of variables.
-#define MAX_VARIABLES 16
+    (*level)++;
+    push_search_level(search, *level, task->var_index, task->values);
+    intersect_domains(search->remaining_values_for[*level], get_domain(quantum_map, task->var_index));
+    search->level_shared[*level] = true;
+    search->task_level = *level;
+
+    return !domain_is_empty(search->remaining_values_for[*level]);
+}
 
-void enforce_multi_arc_constraints(QuantumMap *quantum_map, Constraints constraints)
+// Donate values
+// Hand the values left to try at the lowest level that has any to the work pool. As every lower level then has no
+// values left to try, running out of values at a shared level means this search has nothing left to try at all.
+void donate_search_values(Search *search, size_t level)
 {
-    // Array to store bitfield for each variable constrained by an arc
-    uint64_t var_bitfield[MAX_VARIABLES];
-#define primary_bitfield (var_bitfield[0]) // Access the first element of `var_bitfields` as `primary_bitfield`
+    for (size_t l = 1; l <= level; l++)
+    {
+        Domain *remaining = search->remaining_values_for + l;
+        if (domain_is_empty(*remaining))
+            continue;
 
-    // Initialise array of possible values for each variable
-    int var_value[MAX_VARIABLES];
-#define primary_value (var_value[0]) // Access the first element of `var_values` as `primary_value`
+        SearchTask *task = create_search_task(search->decision_var + 1, search->decision_value + 1, l - 1, search->decision_var[l], *remaining);
+        clear_domain(*remaining);
+        search->level_shared[l] = true;
+        push_search_task(search->pool, search->worker_index, task);
+        return;
+    }
+}
 
-    // Enforce each arc
-    for (size_t arc_index = 0; arc_index < constraints.multi_arcs_count; arc_index++)
+// Run search
+// The variable to collapse next is chosen by `options.variable_order`. Each variable is collapsed in turn, with each collapse pushing a new level onto the trail. When a
+// collapse leads to a variable with no possible values, the conflict is explained in terms of the levels
+// of the collapses that caused it, and the search jumps straight back to the most recent of those levels
+// (undoing every level in between), rather than to the previous level. The collapses that caused the
+// conflict are also learned as a nogood, so that the same combination is not tried again elsewhere.
+SolveStatus run_search(Search *search, SearchTask *task)
+{
+    clock_t start_time = clock();
+
+    QuantumMap *quantum_map = search->quantum_map;
+    Propagator *propagator = search->propagator;
+    Trail *trail = propagator->trail;
+    SolveOptions *options = &search->options;
+    SolveStats *stats = &search->stats;
+
+    size_t *decision_var = search->decision_var;
+    int *decision_value = search->decision_value;
+    Domain *remaining_values_for = search->remaining_values_for;
+    LevelSet *conflict_sets = search->conflict_sets;
+    LevelSet *conflict = &search->conflict;
+
+    // Every search starts from the root (nogoods learned by earlier searches are kept, as they hold everywhere)
+    undo_to_level(trail, 0);
+    search->task_level = 0;
+
+    size_t level = 0;
+    bool valid_solution = true;
+    bool task_level_pushed = false;
+    SolveStatus status = SOLVE_STATUS__SOLVED;
+
+    if (task != NULL)
     {
-        Arc *arc = constraints.multi_arcs + arc_index;
-        size_t primary_index = arc->variable_indexes[0];
-        size_t total_variables = arc->variable_indexes_count;
+        if (!start_search_task(search, task, &level))
+            status = SOLVE_STATUS__EXHAUSTED;
+        task_level_pushed = true;
+    }
 
-        // Ensure arc is not on too many variables
-        if (arc->variable_indexes_count > MAX_VARIABLES)
+    while (status == SOLVE_STATUS__SOLVED)
+    {
+        if (solve_cancelled(options))
         {
-            fprintf(stderr, "Internal error: We are currently unable to enforce arcs that constrain more than %d variables.", MAX_VARIABLES);
-            exit(EXIT_FAILURE);
+            status = SOLVE_STATUS__CANCELLED;
+            break;
         }
 
-        // Store bitfield of each variable that is constrained by the arc
-        for (size_t i = 0; i < total_variables; i++)
+        if (search->pool != NULL && search_pool_wants_task(search->pool))
+            donate_search_values(search, level);
+
+        // 1. If the solution is valid, move onto the next variable
+        if (task_level_pushed)
+            task_level_pushed = false;
+        else if (valid_solution)
         {
-            size_t var_index = arc->variable_indexes[i];
-            var_bitfield[i] = quantum_map->variables[var_index];
+            size_t var_index;
+            // NOTE: With the lexical order, every variable before the one collapsed at the current level
+            //       had already been collapsed when it was chosen (and domains have only narrowed since).
+            //       That does not hold for the variable of a task, so the level of a task scans every variable.
+            size_t first_index = level == search->task_level ? 0 : decision_var[level];
+            if (!select_variable(propagator, options->variable_order, first_index, &var_index))
+                break; // Solution complete
+
+            level++;
+            push_search_level(search, level, var_index, get_domain(quantum_map, var_index));
         }
 
-        // Test each potential value for the first variable to see if it should be eliminated
-        for (primary_value = 0; primary_value < 64; primary_value++)
+        // 2. If the solution is not valid, jump back to the most recent level involved in the conflict
+        else
         {
-            // Skip this value if it is already not a possibility
-            if (!value_in_bitfield(primary_value, primary_bitfield))
-                continue;
+            stats->conflicts++;
+            size_t levels_skipped = 0;
 
-            // Reset the value of each variable to 0. These will be incremented as we test different combinations of possible values.
-            for (size_t n = 1; n < MAX_VARIABLES; n++)
-                var_value[n] = 0;
+            clear_level_set(conflict);
+            explain_conflict(propagator, conflict);
+            learn_nogood_from_levels(propagator, conflict, decision_var, decision_value, stats);
 
-            // Determine if this value is a valid possibility
-            bool primary_value_is_valid_possibility = false;
             while (true)
             {
-                // For as long as the set of non-primary variable values is not possible, increment the set.
+                // 2.1. If no collapses were involved in the conflict, there is no valid solution
+                if (conflict->levels_count == 0)
                 {
-                    bool end_of_possible_values = false;
-                    size_t n = 1;
-                    while (n < total_variables)
-                    {
-                        // NOTE: This loop is written in such a way that if var_bitfield[1] is 0, the loop will run indefinitely!
-                        //       This is a quick and easy way to stop that from happening, and just quit the function quickly
-                        //       so that `solve` can report an error.
-                        if (var_bitfield[n] == 0)
-                        {
-                            end_of_possible_values = true;
-                            return;
-                        }
-
-                        if (value_in_bitfield(var_value[n], var_bitfield[n]))
-                        {
-                            n++;
-                            continue;
-                        }
-
-                        var_value[n]++;
-
-                        while (var_value[n] == 64)
-                        {
-                            n++;
-
-                            if (n >= total_variables)
-                            {
-                                end_of_possible_values = true;
-                                break;
-                            }
-
-                            var_value[n]++;
-                        }
-
-                        for (size_t v = 1; v < n; v++)
-                            var_value[v] = 0;
-
-                        n = 1;
-                    }
-
-                    if (end_of_possible_values)
-                        break;
+                    status = SOLVE_STATUS__UNSATISFIABLE;
+                    break;
                 }
 
-                // Evaluate the set of possible variables to determine if the primary value is a valid possibility
-                int result = evaluate_arc_expression(arc, arc->expr, var_value, arc->instance_indexes);
+                // 2.2. Restore each variable to how it was before the culprit level collapsed its variable
+                size_t from_level = level;
+                level = max_level(conflict);
+                remove_level(conflict, level);
 
-                if (result != 0)
-                {
-                    primary_value_is_valid_possibility = true;
-                    break;
-                }
+                // NOTE: Levels that still had values left to try are levels chronological backtracking would have explored
+                for (size_t l = level + 1; l <= from_level; l++)
+                    if (!domain_is_empty(remaining_values_for[l]))
+                        levels_skipped++;
+
+                undo_to_level(trail, level - 1);
+                merge_level_sets(conflict_sets + level, conflict);
 
-                // Increment the set of variable values (excluding the primary variable)
+                // 2.3. If there are remaining values to try, try the next one
+                if (!domain_is_empty(remaining_values_for[level]))
                 {
-                    size_t n = 1;
-                    while (n < total_variables)
+                    if (levels_skipped > 0)
                     {
-                        var_value[n]++;
-
-                        if (var_value[n] < 64)
-                            break;
-
-                        var_value[n] = 0;
-                        n++;
+                        stats->backjumps++;
+                        stats->levels_skipped += levels_skipped;
                     }
 
-                    if (n >= total_variables)
-                        break;
+                    push_level(trail);
+                    break;
                 }
-            }
-
-            if (!primary_value_is_valid_possibility)
-                primary_bitfield -= (1ULL << primary_value);
-        }
-
-        quantum_map->variables[primary_index] = primary_bitfield;
-    }
-#undef var_bitfield
-#undef var_value
-}
-
-// Reset solution values
-void reset_solution_values(QuantumMap *quantum_map, int ignore_index_and_before)
-{
-    for (size_t i = 0; i < quantum_map->instances_count; i++)
-    {
-        QuantumInstance *instance = quantum_map->instances + i;
-        Node *node = instance->node;
-        for (size_t p = 0; p < node->properties_count; p++)
-        {
-            int v = instance->variables_array_index + p;
-            if (v <= ignore_index_and_before)
-                continue;
 
-            Property *property = node->properties + p;
-
-            if (property->type.primitive == TYPE_PRIMITIVE__NUMBER)
-            {
-                quantum_map->variables[v] = UINT64_MAX;
-            }
-
-            else if (property->type.primitive == TYPE_PRIMITIVE__BOOL)
-            {
-                quantum_map->variables[v] = 0b11;
-            }
-
-            else if (property->type.primitive == TYPE_PRIMITIVE__NODE)
-            {
-                uint64_t bitfield = 0;
-                for (size_t k = 0; k < 64; k++)
+                // 2.4. If some other task is trying the rest of the values at this level, this search has nothing
+                //      left to try
+                if (search->level_shared[level])
                 {
-                    if (k >= quantum_map->instances_count)
-                        break;
-
-                    if (quantum_map->instances[k].node == property->type.node)
-                        bitfield = bitfield | (1ULL << k);
+                    status = SOLVE_STATUS__EXHAUSTED;
+                    break;
                 }
 
-                quantum_map->variables[v] = bitfield;
+                // 2.5. Otherwise, every value at this level has been ruled out. The conflict is then caused by
+                //      whatever ruled out each value, and whatever narrowed the variable in the first place.
+                clear_level_set(conflict);
+                merge_level_sets(conflict, conflict_sets + level);
+                explain_variable(propagator, decision_var[level], conflict);
+                learn_nogood_from_levels(propagator, conflict, decision_var, decision_value, stats);
             }
 
-            else
-            {
-                fprintf(stderr, "Internal error: Encountered %s while resetting variables", type_primitive_string(property->type.primitive));
-                exit(EXIT_FAILURE);
-            }
+            if (status != SOLVE_STATUS__SOLVED)
+                break;
         }
+
+        // 3. Collapse the variable to a random remaining value
+        // NOTE: Only the ends of a bounds domain can be removed from it, so once a random value has been
+        //       tried (and failed), the rest of a bounds domain is tried in order from its smallest value.
+        //       This may try the first value again, but it means every value is eventually tried.
+        //       (`valid_solution` is still true here only if the level was just pushed.)
+        size_t var_index = decision_var[level];
+        int value;
+        if (remaining_values_for[level].kind == DOMAIN_KIND__BOUNDS && !valid_solution)
+            value = first_domain_value(remaining_values_for[level]);
+        else
+            value = pick_domain_value(remaining_values_for[level], next_random(&search->random));
+
+        remove_domain_value(remaining_values_for[level], value);
+        decision_value[level] = value;
+        collapse_variable(propagator, var_index, value, DECISION_REASON);
+        stats->decisions++;
+
+        // 4. Apply constraints, propagating until there is no pending work
+        valid_solution = propagate(propagator);
     }
+
+    record_propagator_stats(stats, propagator);
+    stats->status = status;
+    stats->seconds += (double)(clock() - start_time) / CLOCKS_PER_SEC;
+    return status;
 }
 
 // Solve
-void solve(QuantumMap *quantum_map, Constraints constraints)
+// Searches the whole tree on a single thread
+SolveStats solve(QuantumMap *quantum_map, Constraints constraints, SolveOptions options)
 {
-    reset_solution_values(quantum_map, -1);
+    clock_t start_time = clock();
 
-    int *value_for = (int *)malloc(sizeof(int) * quantum_map->variables_count);
-    uint64_t *remaining_values_for = (uint64_t *)malloc(sizeof(uint64_t) * quantum_map->variables_count);
+    // Everything used by this solve is freed at once when it finishes
+    Arena *arena = create_arena(ARENA_BLOCK_SIZE);
+    Search *search = create_search(quantum_map, &constraints, options, arena);
 
-    int i = -1;
-    bool reapply_single_arc_constraints = true;
-    while (i < (int)quantum_map->variables_count)
-    {
-        // printf("\r%d / %d            ", i, quantum_map->variables_count);
+    if (enforce_root_constraints(search))
+        run_search(search, NULL);
+    else
+        search->stats.status = SOLVE_STATUS__UNSATISFIABLE;
 
-        // printf("%02d / %02d    ", i, quantum_map->variables_count);
-        // for (int n = 0; n < quantum_map->variables_count; n++)
-        //     n <= i ? printf("  %02d", value_for[n]) : printf("    ");
-        // printf("\n");
+    SolveStats stats = search->stats;
+    stats.seconds = (double)(clock() - start_time) / CLOCKS_PER_SEC;
 
-        // 1. Apply constraints
-        if (reapply_single_arc_constraints)
-        {
-            enforce_single_arc_constrains(quantum_map, constraints);
-            reapply_single_arc_constraints = false;
-        }
-        enforce_multi_arc_constraints(quantum_map, constraints);
-
-        // 2. Check if solution is valid
-        bool valid_solution = true;
-        for (size_t n = 0; n < quantum_map->variables_count; n++)
-        {
-            if (quantum_map->variables[n] == 0)
-            {
-                valid_solution = false;
-                break;
-            }
-        }
-
-        // 3. If solution is valid, collapse the next variable to a possible value
-        if (valid_solution)
-        {
-            i++;
-            if (i == (int)quantum_map->variables_count)
-                break; // Solution complete
-
-            remaining_values_for[i] = quantum_map->variables[i];
+    free_search(search);
+    free_arena(arena);
+    return stats;
+}
 
-            int value = rand() % 64;
-            while (!value_in_bitfield(value, remaining_values_for[i]))
-                value = (value + 1) % 64;
+// Solve batch
+SolveBatch *create_solve_batch(QuantumMap *quantum_map, Constraints constraints, SolveOptions options)
+{
+    SolveBatch *batch = NEW(SolveBatch);
+    Arena *arena = create_arena(ARENA_BLOCK_SIZE);
+    batch->arena = arena;
+    batch->constraints = constraints;
+    batch->search = create_search(quantum_map, &batch->constraints, options, arena);
+    batch->root_valid = enforce_root_constraints(batch->search);
+
+    Propagator *propagator = batch->search->propagator;
+    batch->root_domain_words = ARENA_ARRAY(arena, uint64_t, quantum_map->domain_words_count);
+    memcpy(batch->root_domain_words, quantum_map->domain_words, sizeof(uint64_t) * quantum_map->domain_words_count);
+
+    batch->root_seen_words_count = propagator->seen_words_offsets[constraints.channel_watches_count];
+    batch->root_seen_words = ARENA_ARRAY(arena, uint64_t, batch->root_seen_words_count + 1);
+    memcpy(batch->root_seen_words, propagator->seen_words, sizeof(uint64_t) * batch->root_seen_words_count);
+
+    batch->root_arc_weights = ARENA_ARRAY(arena, size_t, constraints.multi_arcs_count + 1);
+    memcpy(batch->root_arc_weights, propagator->arc_weights, sizeof(size_t) * constraints.multi_arcs_count);
+    batch->root_variable_weights = ARENA_ARRAY(arena, size_t, quantum_map->variables_count + 1);
+    memcpy(batch->root_variable_weights, propagator->variable_weights, sizeof(size_t) * quantum_map->variables_count);
+
+    return batch;
+}
 
-            uint64_t bitfield = 1ULL << value;
-            value_for[i] = value;
-            quantum_map->variables[i] = bitfield;
-            remaining_values_for[i] -= bitfield;
+SolveStats solve_batch_sample(SolveBatch *batch, uint64_t seed)
+{
+    clock_t start_time = clock();
 
-            continue;
-        }
+    Search *search = batch->search;
+    QuantumMap *quantum_map = search->quantum_map;
+    Propagator *propagator = search->propagator;
 
-        // 4. If solution is not valid
-        while (true)
-        {
-            // 4.1. If we have exhausted all possible solutions, error
-            if (i == -1)
-            {
-                fprintf(stderr, "Could not find a valid solution");
-                exit(EXIT_FAILURE);
-            }
+    reset_search_stats(search);
+    search->random = create_random(seed);
 
-            // 4.2. If we have exhausted all possible values, fall back to the previous variable
-            if (remaining_values_for[i] == 0)
-            {
-                i--;
-                continue;
-            }
+    if (!batch->root_valid)
+    {
+        search->stats.status = SOLVE_STATUS__UNSATISFIABLE;
+        return search->stats;
+    }
 
-            // 4.3. Select a random remaining value the variable could collapse to
-            int value = rand() % 64;
-            while (!value_in_bitfield(value, remaining_values_for[i]))
-                value = (value + 1) % 64;
+    // Restore the snapshot (which leaves nothing on the trail worth undoing)
+    clear_trail(propagator->trail);
+    memcpy(quantum_map->domain_words, batch->root_domain_words, sizeof(uint64_t) * quantum_map->domain_words_count);
+    memcpy(propagator->seen_words, batch->root_seen_words, sizeof(uint64_t) * batch->root_seen_words_count);
+    memcpy(propagator->arc_weights, batch->root_arc_weights, sizeof(size_t) * batch->constraints.multi_arcs_count);
+    memcpy(propagator->variable_weights, batch->root_variable_weights, sizeof(size_t) * quantum_map->variables_count);
+    forget_nogoods(propagator->nogoods);
 
-            value_for[i] = value;
-            remaining_values_for[i] -= 1ULL << value;
+    run_search(search, NULL);
 
-            break;
-        }
+    SolveStats stats = search->stats;
+    stats.seconds = (double)(clock() - start_time) / CLOCKS_PER_SEC;
+    return stats;
+}
 
-        // 5. Reset solution values
-        reset_solution_values(quantum_map, i);
-        for (int n = 0; n <= i; n++)
-            quantum_map->variables[n] = 1ULL << value_for[n];
+void free_solve_batch(SolveBatch *batch)
+{
+    free_search(batch->search);
+    free_arena(batch->arena);
+    free(batch);
+}
 
-        reapply_single_arc_constraints = true;
-    }
-    // printf("\n");
+// Printing & strings
+void print_solve_stats(SolveStats stats)
+{
+    printf("decisions:       %zu\n", stats.decisions);
+    printf("conflicts:       %zu\n", stats.conflicts);
+    printf("backjumps:       %zu (%zu levels skipped)\n", stats.backjumps, stats.levels_skipped);
+    printf("nogoods learned: %zu\n", stats.nogoods_learned);
+    printf("max level:       %zu\n", stats.max_level);
+    printf("arcs revised:    %zu\n", stats.arcs_revised);
+    printf("nogoods checked: %zu\n", stats.nogoods_checked);
+    printf("watches revised: %zu\n", stats.watches_revised);
+    printf("all different:   %zu revised\n", stats.all_differents_revised);
+    printf("time:            %.3fs\n", stats.seconds);
 }
@@ -1,9 +1,142 @@
 #ifndef SOLVE_H
 #define SOLVE_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "conflict.h"
 #include "constraints.h"
+#include "propagate.h"
 #include "quantum_map.h"
+#include "random.h"
+#include "variable_order.h"
+
+// SolveOptions
+typedef struct
+{
+    VariableOrder variable_order;
+    uint64_t seed; // Seed for the random values the search tries
+
+    // If not NULL, the search gives up as soon as this is set (from another thread)
+    bool *cancel;
+} SolveOptions;
+
+// SolveStatus
+typedef enum
+{
+    SOLVE_STATUS__SOLVED,
+    SOLVE_STATUS__UNSATISFIABLE, // There is no valid solution
+    SOLVE_STATUS__CANCELLED,
+    SOLVE_STATUS__EXHAUSTED, // There is no valid solution in the part of the search tree a task was given
+} SolveStatus;
+
+// SolveStats
+typedef struct
+{
+    SolveStatus status;
+    size_t decisions;       // Number of times a variable was collapsed
+    size_t conflicts;       // Number of times propagation failed
+    size_t backjumps;       // Number of times the search jumped back past levels that still had values to try
+    size_t levels_skipped;  // Total number of such levels that backjumps skipped over
+    size_t nogoods_learned; // Number of nogoods stored
+    size_t max_level;       // Deepest level the search reached
+    size_t arcs_revised;
+    size_t nogoods_checked;
+    size_t watches_revised;
+    size_t all_differents_revised;
+    double seconds;
+} SolveStats;
+
+// Solve
+// Collapses every variable of the quantum map to a single value. If there is no valid solution (or the search is
+// cancelled), the domains of the quantum map are left partially narrowed.
+SolveStats solve(QuantumMap *quantum_map, Constraints constraints, SolveOptions options);
+
+// SearchTask
+// A part of the search tree that can be searched on its own: every collapse in the prefix is made (in order), and
+// then `var_index` is collapsed to each of `values` in turn. The task owns the words of `values`.
+typedef struct
+{
+    size_t *prefix_var;
+    int *prefix_value;
+    size_t prefix_count;
+    size_t var_index;
+    Domain values;
+} SearchTask;
+
+SearchTask *create_search_task(size_t *prefix_var, int *prefix_value, size_t prefix_count, size_t var_index, Domain values);
+void free_search_task(SearchTask *task);
+
+// Search
+// The state of one backtracking search over its own quantum map. A search can be run over the whole tree, or over
+// the part of the tree given by a task. While a search is part of a work pool (see work_stealing.h), it hands the
+// values it has left to try near the root to the pool whenever another worker is idle.
+//
+// A level is shared when values that were left to try at it (or, for the levels of a task, any of its other values)
+// belong to some other task. Running out of values at a shared level only means this search's part of the tree has
+// no solution, so the search stops there rather than explaining the conflict.
+typedef struct WorkPool WorkPool;
+
+typedef struct
+{
+    QuantumMap *quantum_map;
+    Propagator *propagator;
+    SolveOptions options;
+    Random random;
+
+    // Each level collapses one variable. Level 0 is the root, where nothing has been collapsed.
+    size_t *decision_var;
+    int *decision_value;
+    Domain *remaining_values_for;
+    uint64_t *remaining_words;
+    LevelSet *conflict_sets;
+    LevelSet conflict;
+    bool *level_shared;
+    size_t levels_count;
+    size_t task_level; // The level of the variable the current task collapses (0 for the whole tree)
+
+    WorkPool *pool; // NULL unless the search is one of several workers
+    size_t worker_index;
+
+    SolveStats stats;
+} Search;
+
+Search *create_search(QuantumMap *quantum_map, Constraints *constraints, SolveOptions options, Arena *arena);
+void free_search(Search *search);
+void reset_search_stats(Search *search);
+
+// Enforce constraints on the initial values of each variable. Returns false if there is no valid solution.
+bool enforce_root_constraints(Search *search);
+
+// Search for a solution, either in the whole tree (if `task` is NULL) or in the task's part of the tree
+SolveStatus run_search(Search *search, SearchTask *task);
+
+// SolveBatch
+// Solves the same quantum map many times over, each time with a different seed. Constraints are only enforced at the
+// root once: the domains this leaves (including the domains each channel watch has seen) are snapshotted, along with
+// the failure counters, and each solve starts by copying the snapshot back, rather than undoing the previous solve or
+// propagating again. Nogoods learned by earlier solves are forgotten, so each solve searches exactly as it would have
+// if it were the only one (and does not slow down checking nogoods that piled up over earlier solves).
+typedef struct
+{
+    Arena *arena;
+    Constraints constraints;
+    Search *search;
+    bool root_valid; // False if enforcing constraints at the root already showed there is no valid solution
+
+    uint64_t *root_domain_words;
+    uint64_t *root_seen_words;
+    size_t root_seen_words_count;
+    size_t *root_arc_weights;
+    size_t *root_variable_weights;
+} SolveBatch;
+
+SolveBatch *create_solve_batch(QuantumMap *quantum_map, Constraints constraints, SolveOptions options);
+SolveStats solve_batch_sample(SolveBatch *batch, uint64_t seed);
+void free_solve_batch(SolveBatch *batch);
 
-void solve(QuantumMap *quantum_map, Constraints constraints);
+// Printing & strings
+void print_solve_stats(SolveStats stats);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "memory.h"
+#include "support_table.h"
+
+// Create support table
+SupportTable *create_support_table(Bytecode *bytecode, QuantumMap *quantum_map, size_t *variable_indexes, size_t variables_count)
+{
+    if (bytecode_reads_instances(bytecode))
+        return NULL;
+
+    QuantumVariable *primary = quantum_map->variables + variable_indexes[0];
+    if (primary->kind != DOMAIN_KIND__BITFIELD)
+        return NULL;
+
+    int *bases = (int *)malloc(sizeof(int) * variables_count);
+    size_t *strides = (size_t *)malloc(sizeof(size_t) * variables_count);
+    size_t *values_counts = (size_t *)malloc(sizeof(size_t) * variables_count);
+
+    // Work out the stride of each other variable, giving up if the table would be too large
+    size_t rows_count = 1;
+    for (size_t n = 1; n < variables_count; n++)
+    {
+        QuantumVariable *variable = quantum_map->variables + variable_indexes[n];
+        bases[n] = variable->base;
+        strides[n] = rows_count;
+        values_counts[n] = variable->values_count;
+        rows_count *= variable->values_count;
+
+        if (variable->kind != DOMAIN_KIND__BITFIELD || rows_count * primary->words_count > MAX_SUPPORT_TABLE_WORDS)
+        {
+            free(bases);
+            free(strides);
+            free(values_counts);
+            return NULL;
+        }
+    }
+
+    SupportTable *table = NEW(SupportTable);
+    table->rows_count = rows_count;
+    table->row_words_count = primary->words_count;
+    table->rows = (uint64_t *)calloc(rows_count * primary->words_count, sizeof(uint64_t));
+    table->bases = bases;
+    table->strides = strides;
+    table->variables_count = variables_count;
+
+    // The bytecode never reads its instances, so it does not matter which ones are written into the registers
+    int registers[MAX_REGISTERS];
+    size_t *instance_indexes = (size_t *)calloc(bytecode->instances_count + 1, sizeof(size_t));
+    prepare_registers(bytecode, registers, instance_indexes);
+    free(instance_indexes);
+
+    for (size_t n = 1; n < variables_count; n++)
+        registers[n] = bases[n];
+
+    // Run the expression for every value of the primary variable, with every combination of values of the other variables
+    for (size_t row = 0; row < rows_count; row++)
+    {
+        Domain supported = (Domain){.kind = DOMAIN_KIND__BITFIELD, .words = table->rows + row * table->row_words_count, .words_count = table->row_words_count, .base = primary->base};
+        for (size_t v = 0; v < primary->values_count; v++)
+        {
+            registers[0] = primary->base + (int)v;
+            if (run_bytecode(bytecode, registers) != 0)
+                add_domain_value(supported, registers[0]);
+        }
+
+        // Move onto the next combination (in the same order as the rows)
+        for (size_t n = 1; n < variables_count; n++)
+        {
+            registers[n]++;
+            if (registers[n] < bases[n] + (int)values_counts[n])
+                break;
+
+            registers[n] = bases[n];
+        }
+    }
+
+    free(values_counts);
+    return table;
+}
@@ -0,0 +1,38 @@
+#ifndef SUPPORT_TABLE_H
+#define SUPPORT_TABLE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "bytecode.h"
+#include "quantum_map.h"
+
+// SupportTable
+// When an arc's expression does not read the indexes of its instances, the values of the primary variable that are
+// supported by a combination of values of the other variables are the same for every arc of the rule (with the same
+// rotation). So, these are worked out once when the constraints are created, and stored as a row of words (shaped
+// like the primary variable's domain) for each combination. Revising an arc then only has to OR together the rows of
+// the combinations that are still possible, rather than running the expression for every value of the primary variable.
+// For an arc on two variables, this is a bit-matrix from each value of the other variable to its supported values.
+typedef struct
+{
+    uint64_t *rows;
+    size_t rows_count;
+    size_t row_words_count;
+
+    // The row of a combination is the sum of `(value - bases[n]) * strides[n]` over each other variable `n`
+    // (the entries for the primary variable are unused)
+    int *bases;
+    size_t *strides;
+    size_t variables_count;
+} SupportTable;
+
+// The most words a support table may use
+#define MAX_SUPPORT_TABLE_WORDS (1 << 16)
+
+// Create support table
+// `variable_indexes` are the variables of any one of the arcs the table will be used for (as they all have domains of the
+// same shape). Returns NULL if the bytecode reads any instances, if any variable has a bounds domain, or if the table would be too large.
+SupportTable *create_support_table(Bytecode *bytecode, QuantumMap *quantum_map, size_t *variable_indexes, size_t variables_count);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include "memory.h"
+#include "trail.h"
+
+// Create trail
+Trail *create_trail(size_t variables_count)
+{
+    Trail *trail = NEW(Trail);
+
+    trail->entries_capacity = variables_count + 1;
+    trail->entries_count = 0;
+    trail->entries = (TrailEntry *)malloc(sizeof(TrailEntry) * trail->entries_capacity);
+
+    trail->saved_words_capacity = variables_count + 1;
+    trail->saved_words_count = 0;
+    trail->saved_words = (uint64_t *)malloc(sizeof(uint64_t) * trail->saved_words_capacity);
+
+    trail->events_capacity = variables_count + 1;
+    trail->events_count = 0;
+    trail->events = (TrailEvent *)malloc(sizeof(TrailEvent) * trail->events_capacity);
+
+    trail->levels_capacity = variables_count + 1;
+    trail->levels_count = 0;
+    trail->level_starts = (size_t *)malloc(sizeof(size_t) * trail->levels_capacity);
+    trail->level_event_starts = (size_t *)malloc(sizeof(size_t) * trail->levels_capacity);
+    trail->level_stamps = (size_t *)malloc(sizeof(size_t) * trail->levels_capacity);
+    trail->next_stamp = 1;
+
+    // NOTE: A stamp of 0 is never given to a level, so that changes made before any level is
+    //       pushed (i.e. the initial domains of each variable) are never recorded.
+    trail->variable_stamps = (size_t *)calloc(variables_count + 1, sizeof(size_t));
+
+    return trail;
+}
+
+// Levels
+void push_level(Trail *trail)
+{
+    if (trail->levels_count == trail->levels_capacity)
+    {
+        trail->levels_capacity *= 2;
+        trail->level_starts = (size_t *)realloc(trail->level_starts, sizeof(size_t) * trail->levels_capacity);
+        trail->level_event_starts = (size_t *)realloc(trail->level_event_starts, sizeof(size_t) * trail->levels_capacity);
+        trail->level_stamps = (size_t *)realloc(trail->level_stamps, sizeof(size_t) * trail->levels_capacity);
+    }
+
+    trail->level_starts[trail->levels_count] = trail->entries_count;
+    trail->level_event_starts[trail->levels_count] = trail->events_count;
+    trail->level_stamps[trail->levels_count] = trail->next_stamp++;
+    trail->levels_count++;
+}
+
+// Restore every variable that was changed during the most recent level, and then remove the level
+void undo_level(Trail *trail)
+{
+    if (trail->levels_count == 0)
+        return;
+
+    trail->levels_count--;
+    size_t start = trail->level_starts[trail->levels_count];
+
+    while (trail->entries_count > start)
+    {
+        trail->entries_count--;
+        TrailEntry *entry = trail->entries + trail->entries_count;
+        for (size_t w = 0; w < entry->words_count; w++)
+            entry->domain_words[w] = trail->saved_words[entry->saved_words_start + w];
+        trail->saved_words_count = entry->saved_words_start;
+    }
+
+    trail->events_count = trail->level_event_starts[trail->levels_count];
+}
+
+void undo_to_level(Trail *trail, size_t levels_count)
+{
+    while (trail->levels_count > levels_count)
+        undo_level(trail);
+}
+
+// Forget every level without restoring any variable (for when every variable is restored some other way)
+void clear_trail(Trail *trail)
+{
+    trail->entries_count = 0;
+    trail->saved_words_count = 0;
+    trail->events_count = 0;
+    trail->levels_count = 0;
+}
+
+// Recording changes
+// Record the current domain of a variable, before it is changed. This only needs to happen
+// once per level, as undoing a level restores each variable to how it was when the level was pushed.
+void record_variable(Trail *trail, size_t var_index, Domain domain)
+{
+    if (trail->levels_count == 0)
+        return;
+
+    size_t stamp = trail->level_stamps[trail->levels_count - 1];
+    if (trail->variable_stamps[var_index] == stamp)
+        return;
+
+    trail->variable_stamps[var_index] = stamp;
+
+    if (trail->entries_count == trail->entries_capacity)
+    {
+        trail->entries_capacity *= 2;
+        trail->entries = (TrailEntry *)realloc(trail->entries, sizeof(TrailEntry) * trail->entries_capacity);
+    }
+
+    if (trail->saved_words_count + domain.words_count > trail->saved_words_capacity)
+    {
+        while (trail->saved_words_count + domain.words_count > trail->saved_words_capacity)
+            trail->saved_words_capacity *= 2;
+        trail->saved_words = (uint64_t *)realloc(trail->saved_words, sizeof(uint64_t) * trail->saved_words_capacity);
+    }
+
+    TrailEntry *entry = trail->entries + trail->entries_count;
+    entry->domain_words = domain.words;
+    entry->words_count = domain.words_count;
+    entry->saved_words_start = trail->saved_words_count;
+    trail->entries_count++;
+
+    for (size_t w = 0; w < domain.words_count; w++)
+        trail->saved_words[trail->saved_words_count++] = domain.words[w];
+}
+
+// Log that a variable was narrowed, and why
+void record_event(Trail *trail, size_t var_index, Reason reason)
+{
+    if (trail->levels_count == 0)
+        return;
+
+    if (trail->events_count == trail->events_capacity)
+    {
+        trail->events_capacity *= 2;
+        trail->events = (TrailEvent *)realloc(trail->events, sizeof(TrailEvent) * trail->events_capacity);
+    }
+
+    TrailEvent *event = trail->events + trail->events_count;
+    event->var_index = var_index;
+    event->level = trail->levels_count;
+    event->reason = reason;
+    trail->events_count++;
+}
@@ -0,0 +1,94 @@
+#ifndef TRAIL_H
+#define TRAIL_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "domain.h"
+
+// Trail
+// An undo log of changes to the domains of variables. Before the domain of a variable is changed
+// for the first time at a given level, its previous domain is recorded on the trail. Undoing a level
+// then only has to restore the variables that were changed since the level was pushed.
+//
+// Alongside this, every individual narrowing is logged as an event, along with the reason it happened.
+// Conflict analysis walks these events backwards to find the decisions that led to a conflict.
+
+// ReasonKind
+typedef enum
+{
+    REASON_KIND__INITIAL,  // The variable was narrowed before any decisions were made
+    REASON_KIND__DECISION, // The variable was collapsed by the search
+    REASON_KIND__ARC,      // The variable was narrowed by a multi arc
+    REASON_KIND__NOGOOD,   // The variable was narrowed by a learned nogood
+    REASON_KIND__CHANNEL,  // The variable was narrowed by a channel, between an `x.forward` and a `y.inverse` variable
+    REASON_KIND__ALL_DIFFERENT, // The variable was narrowed by an all different constraint
+    REASON_KIND__SINGLE_ARC,    // The variable was narrowed by a single arc (on a bounds variable) during the search
+} ReasonKind;
+
+// Reason
+typedef struct
+{
+    ReasonKind kind;
+    size_t index; // Index of the multi or single arc or all different constraint, slot of the nogood, or the channel's `x.forward` variable
+    size_t id;    // ID of the nogood (as nogood slots are reused), or the channel's `y.inverse` variable
+} Reason;
+
+#define INITIAL_REASON ((Reason){.kind = REASON_KIND__INITIAL, .index = 0, .id = 0})
+#define DECISION_REASON ((Reason){.kind = REASON_KIND__DECISION, .index = 0, .id = 0})
+
+// TrailEntry
+// The words of the variable's domain before it was changed are saved in the trail's `saved_words`
+typedef struct
+{
+    uint64_t *domain_words; // Where the domain's words are stored
+    size_t words_count;
+    size_t saved_words_start;
+} TrailEntry;
+
+// TrailEvent
+typedef struct
+{
+    size_t var_index;
+    size_t level;
+    Reason reason;
+} TrailEvent;
+
+// Trail
+typedef struct
+{
+    TrailEntry *entries;
+    size_t entries_count;
+    size_t entries_capacity;
+
+    uint64_t *saved_words;
+    size_t saved_words_count;
+    size_t saved_words_capacity;
+
+    TrailEvent *events;
+    size_t events_count;
+    size_t events_capacity;
+
+    size_t *level_starts;       // The index of the first entry of each level
+    size_t *level_event_starts; // The index of the first event of each level
+    size_t *level_stamps;       // A stamp unique to each level that has been pushed
+    size_t levels_count;
+    size_t levels_capacity;
+    size_t next_stamp;
+
+    size_t *variable_stamps; // The stamp of the level at which each variable was last recorded
+} Trail;
+
+Trail *create_trail(size_t variables_count);
+
+// Levels
+void push_level(Trail *trail);
+void undo_level(Trail *trail);
+void undo_to_level(Trail *trail, size_t levels_count);
+void clear_trail(Trail *trail);
+
+// Recording changes
+void record_variable(Trail *trail, size_t var_index, Domain domain);
+void record_event(Trail *trail, size_t var_index, Reason reason);
+
+#endif
\ No newline at end of file
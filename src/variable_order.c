@@ -0,0 +1,69 @@
+#include <string.h>
+
+#include "variable_order.h"
+
+// Selecting variables
+bool select_variable(Propagator *propagator, VariableOrder order, size_t first_index, size_t *var_index)
+{
+    QuantumMap *quantum_map = propagator->quantum_map;
+
+    bool found = false;
+    size_t best_index = 0;
+    size_t best_count = 0;
+    size_t best_weight = 1;
+
+    // Only the lexical order can skip the variables before `first_index`
+    size_t start = order == VARIABLE_ORDER__LEXICAL ? first_index : 0;
+
+    for (size_t v = start; v < quantum_map->variables_count; v++)
+    {
+        size_t count = count_domain_values(get_domain(quantum_map, v));
+        if (count <= 1)
+            continue;
+
+        if (order == VARIABLE_ORDER__LEXICAL)
+        {
+            *var_index = v;
+            return true;
+        }
+
+        size_t weight = order == VARIABLE_ORDER__DOM_WDEG ? propagator->variable_weights[v] : 1;
+
+        // Compare count / weight against the best found so far (without dividing)
+        if (!found || count * best_weight < best_count * weight)
+        {
+            found = true;
+            best_index = v;
+            best_count = count;
+            best_weight = weight;
+        }
+    }
+
+    *var_index = best_index;
+    return found;
+}
+
+// Strings & printing
+VariableOrder variable_order_from_string(const char *string)
+{
+    if (strcmp(string, "lex") == 0)
+        return VARIABLE_ORDER__LEXICAL;
+    if (strcmp(string, "mrv") == 0)
+        return VARIABLE_ORDER__SMALLEST_DOMAIN;
+    if (strcmp(string, "domwdeg") == 0)
+        return VARIABLE_ORDER__DOM_WDEG;
+
+    return VARIABLE_ORDER__INVALID;
+}
+
+const char *variable_order_string(VariableOrder order)
+{
+    if (order == VARIABLE_ORDER__LEXICAL)
+        return "lex";
+    if (order == VARIABLE_ORDER__SMALLEST_DOMAIN)
+        return "mrv";
+    if (order == VARIABLE_ORDER__DOM_WDEG)
+        return "domwdeg";
+
+    return "<INVALID VARIABLE_ORDER>";
+}
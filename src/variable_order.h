@@ -0,0 +1,31 @@
+#ifndef VARIABLE_ORDER_H
+#define VARIABLE_ORDER_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "propagate.h"
+
+// VariableOrder
+// Strategies for choosing which variable the search should collapse next. Only variables
+// with more than one possible value are ever chosen.
+typedef enum
+{
+    VARIABLE_ORDER__INVALID,
+
+    VARIABLE_ORDER__LEXICAL,         // The order the variables appear in the quantum map
+    VARIABLE_ORDER__SMALLEST_DOMAIN, // Fewest possible values first (MRV)
+    VARIABLE_ORDER__DOM_WDEG,        // Fewest possible values relative to how often the variable's arcs have failed
+} VariableOrder;
+
+// Selecting variables
+// Returns false if every variable has already been collapsed to a single value. Every variable before
+// `first_index` must already have been collapsed to a single value (this lets the lexical order pick up
+// where it left off, rather than scanning every variable for every decision).
+bool select_variable(Propagator *propagator, VariableOrder order, size_t first_index, size_t *var_index);
+
+// Strings & printing
+VariableOrder variable_order_from_string(const char *string);
+const char *variable_order_string(VariableOrder order);
+
+#endif
\ No newline at end of file
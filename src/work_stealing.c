@@ -0,0 +1,287 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "arena.h"
+#include "memory.h"
+#include "random.h"
+#include "work_stealing.h"
+
+// Task deques
+void init_task_deque(TaskDeque *deque)
+{
+    INIT_ARRAY(deque->tasks);
+    deque->first = 0;
+    pthread_mutex_init(&deque->mutex, NULL);
+}
+
+void free_task_deque(TaskDeque *deque)
+{
+    for (size_t t = deque->first; t < deque->tasks_count; t++)
+        free_search_task(deque->tasks[t]);
+    free(deque->tasks);
+    pthread_mutex_destroy(&deque->mutex);
+}
+
+void push_task_bottom(TaskDeque *deque, SearchTask *task)
+{
+    pthread_mutex_lock(&deque->mutex);
+    *EXTEND_ARRAY(deque->tasks, SearchTask *) = task;
+    pthread_mutex_unlock(&deque->mutex);
+}
+
+SearchTask *pop_task_bottom(TaskDeque *deque)
+{
+    SearchTask *task = NULL;
+    pthread_mutex_lock(&deque->mutex);
+    if (deque->tasks_count > deque->first)
+        task = deque->tasks[--deque->tasks_count];
+    if (deque->tasks_count == deque->first)
+    {
+        deque->tasks_count = 0;
+        deque->first = 0;
+    }
+    pthread_mutex_unlock(&deque->mutex);
+    return task;
+}
+
+SearchTask *steal_task_top(TaskDeque *deque)
+{
+    SearchTask *task = NULL;
+    pthread_mutex_lock(&deque->mutex);
+    if (deque->tasks_count > deque->first)
+        task = deque->tasks[deque->first++];
+    if (deque->tasks_count == deque->first)
+    {
+        deque->tasks_count = 0;
+        deque->first = 0;
+    }
+    pthread_mutex_unlock(&deque->mutex);
+    return task;
+}
+
+// Work pool
+bool search_pool_wants_task(WorkPool *pool)
+{
+    return __atomic_load_n(&pool->idle_workers, __ATOMIC_RELAXED) > 0 && __atomic_load_n(&pool->queued_tasks, __ATOMIC_RELAXED) == 0;
+}
+
+void push_search_task(WorkPool *pool, size_t worker_index, SearchTask *task)
+{
+    // NOTE: The task is counted before it is pushed, so that the counts never drop below the tasks that exist.
+    //       A worker that wakes up before the task is pushed just looks for it again.
+    pthread_mutex_lock(&pool->idle_mutex);
+    __atomic_add_fetch(&pool->pending_tasks, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&pool->queued_tasks, 1, __ATOMIC_RELAXED);
+    pthread_cond_broadcast(&pool->idle_condition);
+    pthread_mutex_unlock(&pool->idle_mutex);
+
+    push_task_bottom(pool->deques + worker_index, task);
+}
+
+// Take a task from the worker's own deque, or steal one from another worker. If there are none, wait until one is
+// pushed. Returns false once there are no tasks left at all, or the solve has been cancelled.
+bool take_search_task(WorkPool *pool, size_t worker_index, SearchTask **task)
+{
+    while (true)
+    {
+        if (__atomic_load_n(&pool->cancel, __ATOMIC_ACQUIRE))
+            return false;
+
+        *task = pop_task_bottom(pool->deques + worker_index);
+        for (size_t d = 1; d < pool->workers_count && *task == NULL; d++)
+        {
+            *task = steal_task_top(pool->deques + (worker_index + d) % pool->workers_count);
+            if (*task != NULL)
+                __atomic_add_fetch(&pool->tasks_stolen, 1, __ATOMIC_RELAXED);
+        }
+
+        if (*task != NULL)
+        {
+            __atomic_sub_fetch(&pool->queued_tasks, 1, __ATOMIC_RELAXED);
+            return true;
+        }
+
+        pthread_mutex_lock(&pool->idle_mutex);
+        if (pool->queued_tasks == 0 && pool->pending_tasks > 0 && !pool->cancel)
+        {
+            __atomic_add_fetch(&pool->idle_workers, 1, __ATOMIC_RELAXED);
+            pthread_cond_wait(&pool->idle_condition, &pool->idle_mutex);
+            __atomic_sub_fetch(&pool->idle_workers, 1, __ATOMIC_RELAXED);
+        }
+
+        bool finished = pool->pending_tasks == 0 || pool->cancel;
+        pthread_mutex_unlock(&pool->idle_mutex);
+
+        if (finished)
+            return false;
+    }
+}
+
+// Record how a task finished. A solution or a conflict that does not depend on any collapse ends the whole solve.
+void finish_search_task(WorkPool *pool, size_t worker_index, SolveStatus status)
+{
+    pthread_mutex_lock(&pool->idle_mutex);
+
+    if (status == SOLVE_STATUS__SOLVED)
+    {
+        size_t no_winner = SIZE_MAX;
+        if (__atomic_compare_exchange_n(&pool->winner_index, &no_winner, worker_index, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            __atomic_store_n(&pool->cancel, true, __ATOMIC_RELEASE);
+    }
+    else if (status == SOLVE_STATUS__UNSATISFIABLE)
+        __atomic_store_n(&pool->cancel, true, __ATOMIC_RELEASE);
+
+    __atomic_sub_fetch(&pool->pending_tasks, 1, __ATOMIC_RELAXED);
+    if (pool->pending_tasks == 0 || pool->cancel)
+        pthread_cond_broadcast(&pool->idle_condition);
+
+    pthread_mutex_unlock(&pool->idle_mutex);
+}
+
+// SplitWorker
+typedef struct
+{
+    QuantumMap *quantum_map; // The worker's own copy of the quantum map
+    Constraints constraints;
+    SolveOptions options;
+    WorkPool *pool;
+    size_t index;
+
+    SolveStats stats;
+    size_t tasks_count;
+} SplitWorker;
+
+void *run_split_worker(void *argument)
+{
+    SplitWorker *worker = (SplitWorker *)argument;
+    WorkPool *pool = worker->pool;
+
+    Arena *arena = create_arena(ARENA_BLOCK_SIZE);
+    Search *search = create_search(worker->quantum_map, &worker->constraints, worker->options, arena);
+    search->pool = pool;
+    search->worker_index = worker->index;
+
+    // The first worker searches the whole tree, and every other worker waits for it to make tasks
+    // NOTE: Enforcing constraints at the root gives every worker the same domains, so if it fails for one worker, it
+    //       fails for the first worker too (which then ends the solve)
+    if (!enforce_root_constraints(search))
+    {
+        if (worker->index == 0)
+            finish_search_task(pool, worker->index, SOLVE_STATUS__UNSATISFIABLE);
+    }
+    else
+    {
+        if (worker->index == 0)
+        {
+            worker->tasks_count++;
+            finish_search_task(pool, worker->index, run_search(search, NULL));
+        }
+
+        SearchTask *task;
+        while (take_search_task(pool, worker->index, &task))
+        {
+            SolveStatus status = run_search(search, task);
+            free_search_task(task);
+            worker->tasks_count++;
+            finish_search_task(pool, worker->index, status);
+        }
+    }
+
+    worker->stats = search->stats;
+    free_search(search);
+    free_arena(arena);
+    return NULL;
+}
+
+// Solve split
+SplitStats solve_split(QuantumMap *quantum_map, Constraints constraints, SolveOptions options, size_t workers_count)
+{
+    clock_t start_time = clock();
+
+    WorkPool pool;
+    pool.deques = (TaskDeque *)malloc(sizeof(TaskDeque) * workers_count);
+    for (size_t w = 0; w < workers_count; w++)
+        init_task_deque(pool.deques + w);
+    pool.workers_count = workers_count;
+    pool.idle_workers = 0;
+    pool.queued_tasks = 0;
+    pool.pending_tasks = 1; // The whole tree
+    pool.tasks_stolen = 0;
+    pthread_mutex_init(&pool.idle_mutex, NULL);
+    pthread_cond_init(&pool.idle_condition, NULL);
+    pool.cancel = false;
+    pool.winner_index = SIZE_MAX;
+
+    SplitWorker *workers = (SplitWorker *)malloc(sizeof(SplitWorker) * workers_count);
+    pthread_t *thread_ids = (pthread_t *)malloc(sizeof(pthread_t) * workers_count);
+
+    for (size_t w = 0; w < workers_count; w++)
+    {
+        SplitWorker *worker = workers + w;
+        worker->quantum_map = copy_quantum_map(quantum_map);
+        worker->constraints = constraints;
+        worker->options = options;
+        worker->options.seed = w == 0 ? options.seed : derive_seed(options.seed, w);
+        worker->options.cancel = &pool.cancel;
+        worker->pool = &pool;
+        worker->index = w;
+        worker->tasks_count = 0;
+
+        if (pthread_create(thread_ids + w, NULL, run_split_worker, worker) != 0)
+        {
+            fprintf(stderr, "Unable to create solver thread\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for (size_t w = 0; w < workers_count; w++)
+        pthread_join(thread_ids[w], NULL);
+
+    SplitStats stats;
+    SolveStats *solve_stats = &stats.solve_stats;
+    *solve_stats = workers[0].stats;
+    stats.tasks_count = workers[0].tasks_count;
+    for (size_t w = 1; w < workers_count; w++)
+    {
+        SolveStats *worker_stats = &workers[w].stats;
+        solve_stats->decisions += worker_stats->decisions;
+        solve_stats->conflicts += worker_stats->conflicts;
+        solve_stats->backjumps += worker_stats->backjumps;
+        solve_stats->levels_skipped += worker_stats->levels_skipped;
+        solve_stats->nogoods_learned += worker_stats->nogoods_learned;
+        if (worker_stats->max_level > solve_stats->max_level)
+            solve_stats->max_level = worker_stats->max_level;
+        solve_stats->arcs_revised += worker_stats->arcs_revised;
+        solve_stats->nogoods_checked += worker_stats->nogoods_checked;
+        solve_stats->watches_revised += worker_stats->watches_revised;
+        solve_stats->all_differents_revised += worker_stats->all_differents_revised;
+        stats.tasks_count += workers[w].tasks_count;
+    }
+
+    // Without a solution, the solve only ends once every task has been searched (or the conflict that ended it does
+    // not depend on any collapse), so there is no valid solution
+    stats.winner_index = pool.winner_index;
+    stats.tasks_stolen = pool.tasks_stolen;
+    if (pool.winner_index != SIZE_MAX)
+    {
+        solve_stats->status = SOLVE_STATUS__SOLVED;
+        copy_domain_words(quantum_map, workers[pool.winner_index].quantum_map);
+    }
+    else
+        solve_stats->status = SOLVE_STATUS__UNSATISFIABLE;
+    solve_stats->seconds = (double)(clock() - start_time) / CLOCKS_PER_SEC;
+
+    for (size_t w = 0; w < workers_count; w++)
+    {
+        free_quantum_map_copy(workers[w].quantum_map);
+        free_task_deque(pool.deques + w);
+    }
+    free(pool.deques);
+    free(workers);
+    free(thread_ids);
+    pthread_mutex_destroy(&pool.idle_mutex);
+    pthread_cond_destroy(&pool.idle_condition);
+
+    return stats;
+}
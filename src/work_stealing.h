@@ -0,0 +1,71 @@
+#ifndef WORK_STEALING_H
+#define WORK_STEALING_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "constraints.h"
+#include "quantum_map.h"
+#include "solve.h"
+
+// Work stealing
+// Splits one search tree between several workers, each on its own thread with its own copy of the quantum map's
+// domains (and its own propagator, trail and nogoods). The first worker starts on the whole tree. Whenever a worker
+// is idle and no task is waiting, a busy worker hands the values it has left to try at its lowest level to the pool
+// as a task, which the idle worker then searches by redoing the collapses that lead to it.
+//
+// Unlike a portfolio, no part of the tree is searched twice, so searching the whole tree (e.g. to show that there
+// is no valid solution) is shared between the workers rather than repeated by each of them.
+
+// TaskDeque
+// Each worker pushes the tasks it makes onto the bottom of its own deque (and takes its own tasks back from the
+// bottom), while other workers steal from the top, where the tasks nearest the root are.
+// NOTE: Each deque is guarded by a mutex rather than being lock-free. Tasks are only made while some worker is idle,
+//       so the deques are rarely touched, let alone contended.
+typedef struct
+{
+    SearchTask **tasks;
+    size_t tasks_count; // One past the task at the bottom of the deque
+    size_t tasks_capacity;
+    size_t first; // The task at the top of the deque
+    pthread_mutex_t mutex;
+} TaskDeque;
+
+// WorkPool
+struct WorkPool
+{
+    TaskDeque *deques; // One per worker
+    size_t workers_count;
+
+    // The counts are changed atomically, so that busy workers can check them without taking the mutex
+    size_t idle_workers;
+    size_t queued_tasks;  // Tasks waiting in a deque
+    size_t pending_tasks; // Tasks that have not finished, including the ones being searched
+    size_t tasks_stolen;
+    pthread_mutex_t idle_mutex;
+    pthread_cond_t idle_condition;
+
+    bool cancel;
+    size_t winner_index; // The worker that found a solution (SIZE_MAX until one does)
+};
+
+// Returns true if a worker is waiting for a task, and none is queued
+bool search_pool_wants_task(WorkPool *pool);
+void push_search_task(WorkPool *pool, size_t worker_index, SearchTask *task);
+
+// SplitStats
+typedef struct
+{
+    SolveStats solve_stats; // Summed over every worker (the status and time are for the whole solve)
+    size_t tasks_count;     // Number of tasks searched, including the whole tree
+    size_t tasks_stolen;    // Number of tasks searched by a worker other than the one that made them
+    size_t winner_index;    // The worker that found the solution (if one was found)
+} SplitStats;
+
+// Solve split
+// Collapses every variable of the quantum map to a single value, as `solve` does, but splits the search between
+// `workers_count` threads
+SplitStats solve_split(QuantumMap *quantum_map, Constraints constraints, SolveOptions options, size_t workers_count);
+
+#endif
\ No newline at end of file
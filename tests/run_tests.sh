@@ -0,0 +1,27 @@
+#!/bin/sh
+# Runs every script in this directory with the compiler given (`./main` by default), checking that it finds a solution
+# (exiting with 0) or reports "Could not find a valid solution", as the `// EXPECT: sat|unsat <arguments>` line at the
+# top of the script says
+main="${1:-./main}"
+dir="$(dirname "$0")"
+failures=0
+
+for script in "$dir"/*.sun
+do
+    expect_line="$(head -n 1 "$script")"
+    expected="$(echo "$expect_line" | awk '{print $3}')"
+    arguments="$(echo "$expect_line" | cut -d' ' -f4-)"
+
+    output="$("$main" "$script" $arguments 2>&1)"
+    status=$?
+    case "$output" in
+        *"Could not find a valid solution"*) status=unsat ;;
+    esac
+
+    case "$expected:$status" in
+        sat:0|unsat:unsat) echo "ok      $script" ;;
+        *) echo "FAILED  $script (expected $expected, exited with $status)"; failures=$((failures + 1)) ;;
+    esac
+done
+
+[ "$failures" -eq 0 ]